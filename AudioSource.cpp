@@ -0,0 +1,87 @@
+#include "AudioSource.h"
+
+using namespace std;
+
+AudioSource::AudioSource(bool real_time)
+{
+	this->realTime = real_time;
+	this->ring = new SampleRing(CAPTURE_RING_SIZE);
+	this->captureThread = NULL;
+	this->capturing = false;
+	this->overruns = 0;
+	return;
+}
+
+int AudioSource::Discard(int keep)
+{
+	// replayed audio is never skipped (deterministic, as fast as the consumer allows)
+	if (!this->realTime)
+		return 0;
+	return this->ring->Discard(keep);
+}
+
+unsigned long AudioSource::GetDroppedSamples() const
+{
+	return this->ring->GetDropped();
+}
+
+void AudioSource::Pace(struct timespec& deadline, int samples)
+{
+	// advance an absolute deadline by the duration of 'samples' and sleep until it
+	if (!this->realTime)
+		return;
+	long nanoseconds = deadline.tv_nsec + (long)((long long)samples * 1000000000LL / SAMP_RATE);
+	deadline.tv_sec += nanoseconds / 1000000000L;
+	deadline.tv_nsec = nanoseconds % 1000000000L;
+	clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL);
+	return;
+}
+
+bool AudioSource::Read(short* buffer, int count)
+{
+	return this->ring->Read(buffer, count);
+}
+
+void AudioSource::Start()
+{
+	// run the producer on a dedicated thread
+	if (this->captureThread != NULL)
+		return;
+	this->capturing = true;
+	this->captureThread = new std::thread(&AudioSource::Capture, this);
+	return;
+}
+
+void AudioSource::Stop()
+{
+	if (this->captureThread == NULL)
+		return;
+	this->capturing = false;
+	this->captureThread->join();
+	delete this->captureThread;
+	this->captureThread = NULL;
+	return;
+}
+
+int AudioSource::Write(const short* buffer, int count)
+{
+	if (this->realTime)
+		return this->ring->Write(buffer, count);
+	// replays wait for the consumer instead of dropping
+	int written = 0;
+	while (written < count && this->capturing.load(memory_order_relaxed))
+	{
+		written += this->ring->Write(buffer + written, min(count - written, this->ring->GetCapacity() - this->ring->GetAvailable()));
+		if (written < count)
+			this_thread::yield();
+	}
+	return written;
+}
+
+AudioSource::~AudioSource()
+{
+	// derived destructors must call Stop() before releasing what Capture() uses
+	this->Stop();
+	delete this->ring;
+	return;
+}
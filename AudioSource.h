@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <time.h>
+
+#include "SampleRing.h"
+
+// capture sample rate
+#define SAMP_RATE 11025
+// samples produced per source thread iteration
+#define CAPTURE_CHUNK_SIZE 256
+// capture ring capacity (samples, power of two)
+#define CAPTURE_RING_SIZE 8192
+
+enum AudioSourceTypes { ALSAAudioSourceType = 0, FileAudioSourceType = 1, SyntheticAudioSourceType = 2 };
+
+// sample producer running on its own thread, consumed through a lock-free ring
+class AudioSource
+{
+public:
+	AudioSource(bool real_time = true);
+	virtual ~AudioSource();
+
+	int Discard(int keep);
+	unsigned long GetDroppedSamples() const;
+	unsigned long GetOverruns() const
+	{
+		return this->overruns.load(std::memory_order_relaxed);
+	}
+	bool IsCapturing() const
+	{
+		return this->capturing.load();
+	}
+	bool Read(short* buffer, int count);
+	void Start();
+	void Stop();
+
+protected:
+	// real time sources drop samples when the consumer falls behind, replays never do
+	bool realTime;
+	SampleRing* ring;
+	std::atomic<bool> capturing;
+	std::atomic<unsigned long> overruns;
+
+	// producer loop, runs until capturing is cleared (or the source runs dry)
+	virtual void Capture() = 0;
+	void Pace(struct timespec& deadline, int samples);
+	int Write(const short* buffer, int count);
+
+private:
+	std::thread* captureThread;
+};
@@ -0,0 +1,58 @@
+#include "BinHistory.h"
+
+using namespace std;
+
+BinHistory::BinHistory(int count, int depth)
+{
+	assert(count > 0 && depth > 0);
+	this->count = count;
+	this->depth = depth;
+	this->head = 0;
+	// pad rows to whole cache lines
+	int row_alignment = BIN_HISTORY_ALIGNMENT / sizeof(int);
+	this->stride = (count + row_alignment - 1) / row_alignment * row_alignment;
+	void* block = NULL;
+	if (posix_memalign(&block, BIN_HISTORY_ALIGNMENT, sizeof(int) * this->stride * depth) != 0)
+		throw runtime_error("Failed to allocate bin history");
+	this->data = (int*)block;
+	this->Clear();
+	return;
+}
+
+int* BinHistory::Append()
+{
+	// move head back one row (oldest row becomes the newest) and reset it
+	this->head = this->head == 0 ? this->depth - 1 : this->head - 1;
+	int* row = this->data + this->head * this->stride;
+	memset(row, 0, sizeof(int) * this->count);
+	return row;
+}
+
+void BinHistory::Clear()
+{
+	memset(this->data, 0, sizeof(int) * this->stride * this->depth);
+	return;
+}
+
+int* BinHistory::Get(int depth)
+{
+	// logical depth order (0 = newest)
+	assert(depth >= 0 && depth < this->depth);
+	int index = this->head + depth;
+	if (index >= this->depth)
+		index -= this->depth;
+	return this->data + index * this->stride;
+}
+
+int* BinHistory::GetRow(int index)
+{
+	// physical storage order (for order independent passes over the whole history)
+	assert(index >= 0 && index < this->depth);
+	return this->data + index * this->stride;
+}
+
+BinHistory::~BinHistory()
+{
+	free(this->data);
+	return;
+}
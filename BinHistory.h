@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cassert>
+#include <stdexcept>
+#include <stdlib.h>
+#include <string.h>
+
+// alignment (bytes) of the history block and of each row
+#define BIN_HISTORY_ALIGNMENT 64
+
+// fixed depth history of frequency bin rows, stored as one contiguous ring buffer
+class BinHistory
+{
+public:
+	BinHistory(int count, int depth);
+	~BinHistory();
+
+	int* Append();
+	void Clear();
+	int GetCount() const
+	{
+		return this->count;
+	}
+	int GetDepth() const
+	{
+		return this->depth;
+	}
+	int* Get(int depth);
+	int* GetRow(int index);
+
+private:
+	int count;
+	int depth;
+	int stride;
+	int head;
+	int* data;
+};
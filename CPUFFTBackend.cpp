@@ -0,0 +1,229 @@
+#include "CPUFFTBackend.h"
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#define CPU_FFT_VECTOR 1
+typedef __m128 fft_vector;
+#define FFT_LOAD(p) _mm_loadu_ps(p)
+#define FFT_STORE(p, v) _mm_storeu_ps(p, v)
+#define FFT_ADD(a, b) _mm_add_ps(a, b)
+#define FFT_SUB(a, b) _mm_sub_ps(a, b)
+#define FFT_MUL(a, b) _mm_mul_ps(a, b)
+#define FFT_SET(a) _mm_set1_ps(a)
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define CPU_FFT_VECTOR 1
+typedef float32x4_t fft_vector;
+#define FFT_LOAD(p) vld1q_f32(p)
+#define FFT_STORE(p, v) vst1q_f32(p, v)
+#define FFT_ADD(a, b) vaddq_f32(a, b)
+#define FFT_SUB(a, b) vsubq_f32(a, b)
+#define FFT_MUL(a, b) vmulq_f32(a, b)
+#define FFT_SET(a) vdupq_n_f32(a)
+#endif
+
+// floats per vector register
+#define FFT_VECTOR_WIDTH 4
+
+using namespace std;
+
+CPUFFTBackend::CPUFFTBackend(int log, int direction)
+{
+	if (log < 1 || log > 22)
+		throw runtime_error("log2_N not supported.  Try between 1 and 22.\n");
+	this->fftLog = log;
+	this->fftSize = 1 << log;
+	this->direction = direction == GPU_FFT_FWD ? -1.0 : 1.0;
+
+	// allocate buffers
+	this->in = new GPU_FFT_COMPLEX[this->fftSize];
+	this->out = new GPU_FFT_COMPLEX[this->fftSize];
+	this->inputReal = new float[this->fftSize];
+	this->inputImaginary = new float[this->fftSize];
+	this->outputReal = new float[this->fftSize];
+	this->outputImaginary = new float[this->fftSize];
+	for (int i = 0; i < this->fftSize; i++)
+	{
+		this->in[i].re = this->in[i].im = 0.0;
+		this->out[i].re = this->out[i].im = 0.0;
+	}
+
+	// precompute twiddle factors for every split-radix stage (sizes 4 and up)
+	this->twiddleReal = new float*[log + 1];
+	this->twiddleImaginary = new float*[log + 1];
+	this->twiddle3Real = new float*[log + 1];
+	this->twiddle3Imaginary = new float*[log + 1];
+	for (int level = 0; level <= log; level++)
+	{
+		this->twiddleReal[level] = this->twiddleImaginary[level] = NULL;
+		this->twiddle3Real[level] = this->twiddle3Imaginary[level] = NULL;
+		if (level < 2)
+			continue;
+		int size = 1 << level;
+		int quarter = size / 4;
+		this->twiddleReal[level] = new float[quarter];
+		this->twiddleImaginary[level] = new float[quarter];
+		this->twiddle3Real[level] = new float[quarter];
+		this->twiddle3Imaginary[level] = new float[quarter];
+		for (int k = 0; k < quarter; k++)
+		{
+			double angle = 2.0 * GPU_FFT_PI * (double)k / (double)size;
+			this->twiddleReal[level][k] = cos(angle);
+			this->twiddleImaginary[level][k] = this->direction * sin(angle);
+			this->twiddle3Real[level][k] = cos(3.0 * angle);
+			this->twiddle3Imaginary[level][k] = this->direction * sin(3.0 * angle);
+		}
+	}
+	return;
+}
+
+void CPUFFTBackend::Butterflies(float* re, float* im, int level)
+{
+	// combine the n/2 transform (u) with the two n/4 transforms (z, z') at [n/2, 3n/4) and [3n/4, n)
+	int quarter = 1 << (level - 2);
+	const float* w_re = this->twiddleReal[level];
+	const float* w_im = this->twiddleImaginary[level];
+	const float* w3_re = this->twiddle3Real[level];
+	const float* w3_im = this->twiddle3Imaginary[level];
+	float* u0_re = re, *u0_im = im;
+	float* u1_re = re + quarter, *u1_im = im + quarter;
+	float* z_re = re + 2 * quarter, *z_im = im + 2 * quarter;
+	float* y_re = re + 3 * quarter, *y_im = im + 3 * quarter;
+	int k = 0;
+
+#ifdef CPU_FFT_VECTOR
+	const fft_vector sign = FFT_SET(this->direction);
+	for (; k + FFT_VECTOR_WIDTH <= quarter; k += FFT_VECTOR_WIDTH)
+	{
+		// a = w^k * z, b = w^3k * z'
+		fft_vector zr = FFT_LOAD(z_re + k), zi = FFT_LOAD(z_im + k);
+		fft_vector yr = FFT_LOAD(y_re + k), yi = FFT_LOAD(y_im + k);
+		fft_vector wr = FFT_LOAD(w_re + k), wi = FFT_LOAD(w_im + k);
+		fft_vector w3r = FFT_LOAD(w3_re + k), w3i = FFT_LOAD(w3_im + k);
+		fft_vector ar = FFT_SUB(FFT_MUL(zr, wr), FFT_MUL(zi, wi));
+		fft_vector ai = FFT_ADD(FFT_MUL(zr, wi), FFT_MUL(zi, wr));
+		fft_vector br = FFT_SUB(FFT_MUL(yr, w3r), FFT_MUL(yi, w3i));
+		fft_vector bi = FFT_ADD(FFT_MUL(yr, w3i), FFT_MUL(yi, w3r));
+		// sum and (direction-signed) difference
+		fft_vector sr = FFT_ADD(ar, br), si = FFT_ADD(ai, bi);
+		fft_vector dr = FFT_MUL(FFT_SUB(ar, br), sign), di = FFT_MUL(FFT_SUB(ai, bi), sign);
+		fft_vector ur0 = FFT_LOAD(u0_re + k), ui0 = FFT_LOAD(u0_im + k);
+		fft_vector ur1 = FFT_LOAD(u1_re + k), ui1 = FFT_LOAD(u1_im + k);
+		FFT_STORE(u0_re + k, FFT_ADD(ur0, sr));
+		FFT_STORE(u0_im + k, FFT_ADD(ui0, si));
+		FFT_STORE(z_re + k, FFT_SUB(ur0, sr));
+		FFT_STORE(z_im + k, FFT_SUB(ui0, si));
+		FFT_STORE(u1_re + k, FFT_SUB(ur1, di));
+		FFT_STORE(u1_im + k, FFT_ADD(ui1, dr));
+		FFT_STORE(y_re + k, FFT_ADD(ur1, di));
+		FFT_STORE(y_im + k, FFT_SUB(ui1, dr));
+	}
+#endif
+
+	// scalar fallback (and small stages)
+	for (; k < quarter; k++)
+	{
+		float ar = z_re[k] * w_re[k] - z_im[k] * w_im[k];
+		float ai = z_re[k] * w_im[k] + z_im[k] * w_re[k];
+		float br = y_re[k] * w3_re[k] - y_im[k] * w3_im[k];
+		float bi = y_re[k] * w3_im[k] + y_im[k] * w3_re[k];
+		float sr = ar + br, si = ai + bi;
+		float dr = (ar - br) * this->direction, di = (ai - bi) * this->direction;
+		float ur0 = u0_re[k], ui0 = u0_im[k];
+		float ur1 = u1_re[k], ui1 = u1_im[k];
+		u0_re[k] = ur0 + sr;
+		u0_im[k] = ui0 + si;
+		z_re[k] = ur0 - sr;
+		z_im[k] = ui0 - si;
+		u1_re[k] = ur1 - di;
+		u1_im[k] = ui1 + dr;
+		y_re[k] = ur1 + di;
+		y_im[k] = ui1 - dr;
+	}
+	return;
+}
+
+void CPUFFTBackend::Execute()
+{
+	// split interleaved input into real/imaginary arrays
+	for (int i = 0; i < this->fftSize; i++)
+	{
+		this->inputReal[i] = this->in[i].re;
+		this->inputImaginary[i] = this->in[i].im;
+	}
+
+	// execute fft
+	this->Transform(this->inputReal, this->inputImaginary, 1, this->outputReal, this->outputImaginary, this->fftLog);
+
+	// interleave results into the GPU_FFT output layout
+	for (int i = 0; i < this->fftSize; i++)
+	{
+		this->out[i].re = this->outputReal[i];
+		this->out[i].im = this->outputImaginary[i];
+	}
+	return;
+}
+
+GPU_FFT_COMPLEX* CPUFFTBackend::GetInput()
+{
+	return this->in;
+}
+
+GPU_FFT_COMPLEX* CPUFFTBackend::GetOutput()
+{
+	return this->out;
+}
+
+const char* CPUFFTBackend::GetName()
+{
+	return "CPU";
+}
+
+void CPUFFTBackend::Transform(const float* in_re, const float* in_im, int stride, float* out_re, float* out_im, int level)
+{
+	if (level == 0)
+	{
+		out_re[0] = in_re[0];
+		out_im[0] = in_im[0];
+		return;
+	}
+	if (level == 1)
+	{
+		out_re[0] = in_re[0] + in_re[stride];
+		out_im[0] = in_im[0] + in_im[stride];
+		out_re[1] = in_re[0] - in_re[stride];
+		out_im[1] = in_im[0] - in_im[stride];
+		return;
+	}
+
+	// split-radix decimation in time: even samples (n/2), then samples 4m+1 and 4m+3 (n/4 each)
+	int half = 1 << (level - 1);
+	int quarter = 1 << (level - 2);
+	this->Transform(in_re, in_im, stride * 2, out_re, out_im, level - 1);
+	this->Transform(in_re + stride, in_im + stride, stride * 4, out_re + half, out_im + half, level - 2);
+	this->Transform(in_re + 3 * stride, in_im + 3 * stride, stride * 4, out_re + half + quarter, out_im + half + quarter, level - 2);
+	this->Butterflies(out_re, out_im, level);
+	return;
+}
+
+CPUFFTBackend::~CPUFFTBackend()
+{
+	for (int level = 0; level <= this->fftLog; level++)
+	{
+		delete[] this->twiddleReal[level];
+		delete[] this->twiddleImaginary[level];
+		delete[] this->twiddle3Real[level];
+		delete[] this->twiddle3Imaginary[level];
+	}
+	delete[] this->twiddleReal;
+	delete[] this->twiddleImaginary;
+	delete[] this->twiddle3Real;
+	delete[] this->twiddle3Imaginary;
+	delete[] this->in;
+	delete[] this->out;
+	delete[] this->inputReal;
+	delete[] this->inputImaginary;
+	delete[] this->outputReal;
+	delete[] this->outputImaginary;
+	return;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cmath>
+#include <math.h>
+#include <stdexcept>
+
+#include "FFTBackend.h"
+
+// split-radix fft on the arm/x86 cores (vectorized with NEON/SSE where available)
+class CPUFFTBackend : public FFTBackend
+{
+
+public:
+	CPUFFTBackend(int log, int direction);
+	~CPUFFTBackend();
+
+	GPU_FFT_COMPLEX* GetInput();
+	GPU_FFT_COMPLEX* GetOutput();
+	const char* GetName();
+	void Execute();
+
+private:
+	int fftLog;
+	int fftSize;
+	// +1.0 for inverse (GPU_FFT_REV), -1.0 for forward (GPU_FFT_FWD)
+	float direction;
+	GPU_FFT_COMPLEX* in;
+	GPU_FFT_COMPLEX* out;
+
+	// split real/imaginary working buffers
+	float* inputReal;
+	float* inputImaginary;
+	float* outputReal;
+	float* outputImaginary;
+
+	// twiddle factors w^k and w^3k (k < n/4) for each transform size n = 2^level
+	float** twiddleReal;
+	float** twiddleImaginary;
+	float** twiddle3Real;
+	float** twiddle3Imaginary;
+
+	void Butterflies(float* re, float* im, int level);
+	void Transform(const float* in_re, const float* in_im, int stride, float* out_re, float* out_im, int level);
+
+};
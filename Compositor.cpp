@@ -0,0 +1,116 @@
+#include "Compositor.h"
+
+using namespace std;
+
+Compositor::Compositor(int width, int height, int layer_count)
+{
+	if (width < 1 || height < 1 || layer_count < 1)
+		throw invalid_argument("Invalid compositor dimensions");
+	this->width = width;
+	this->height = height;
+	for (int i = 0; i < layer_count; i++)
+	{
+		Layer layer;
+		layer.rgb = new uint8_t[3 * width * height];
+		memset(layer.rgb, 0, 3 * width * height);
+		layer.mode = OverBlendMode;
+		layer.key = 0;
+		layer.visible = true;
+		this->layers.push_back(layer);
+	}
+	this->rowBuffer = new uint8_t[3 * width];
+	return;
+}
+
+void Compositor::Blend(uint8_t* dst, const uint8_t* src, const Layer& layer)
+{
+	// straight loops over the row (no per pixel mode switch) so the compiler can vectorize them
+	int count = 3 * this->width;
+	switch (layer.mode)
+	{
+		case AddBlendMode:
+			for (int i = 0; i < count; i++)
+			{
+				int value = dst[i] + src[i];
+				dst[i] = value > 255 ? 255 : value;
+			}
+			break;
+		case MultiplyBlendMode:
+			for (int i = 0; i < count; i++)
+			{
+				// rounded (dst * src) / 255
+				int value = dst[i] * src[i] + 128;
+				dst[i] = (value + (value >> 8)) >> 8;
+			}
+			break;
+		case MaxBlendMode:
+			for (int i = 0; i < count; i++)
+			{
+				dst[i] = dst[i] > src[i] ? dst[i] : src[i];
+			}
+			break;
+		default:
+		case OverBlendMode:
+			for (int x = 0; x < this->width; x++)
+			{
+				const uint8_t* pixel = src + 3 * x;
+				uint8_t mask = -(uint8_t)(pixel[0] >= layer.key || pixel[1] >= layer.key || pixel[2] >= layer.key);
+				dst[3 * x] = (pixel[0] & mask) | (dst[3 * x] & ~mask);
+				dst[3 * x + 1] = (pixel[1] & mask) | (dst[3 * x + 1] & ~mask);
+				dst[3 * x + 2] = (pixel[2] & mask) | (dst[3 * x + 2] & ~mask);
+			}
+			break;
+	}
+	return;
+}
+
+void Compositor::ClearLayer(int index)
+{
+	memset(this->layers[index].rgb, 0, 3 * this->width * this->height);
+	return;
+}
+
+void Compositor::Compose(GridTransformer* target)
+{
+	// every layer is applied to a row while it is still in cache, then the row is uploaded once
+	int stride = 3 * this->width;
+	for (int y = 0; y < this->height; y++)
+	{
+		memset(this->rowBuffer, 0, stride);
+		for (size_t i = 0; i < this->layers.size(); i++)
+		{
+			if (this->layers[i].visible)
+				this->Blend(this->rowBuffer, this->layers[i].rgb + y * stride, this->layers[i]);
+		}
+		target->SetRow(y, 0, this->rowBuffer, this->width);
+	}
+	return;
+}
+
+void Compositor::SetBlendMode(int index, BlendModes mode)
+{
+	this->layers[index].mode = mode;
+	return;
+}
+
+void Compositor::SetKey(int index, int key)
+{
+	this->layers[index].key = key;
+	return;
+}
+
+void Compositor::SetVisible(int index, bool visible)
+{
+	this->layers[index].visible = visible;
+	return;
+}
+
+Compositor::~Compositor()
+{
+	for (size_t i = 0; i < this->layers.size(); i++)
+	{
+		delete[] this->layers[i].rgb;
+	}
+	delete[] this->rowBuffer;
+	return;
+}
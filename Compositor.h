@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <stdexcept>
+#include <string.h>
+#include <vector>
+
+#include "GridTransformer.h"
+
+enum BlendModes { OverBlendMode = 0, AddBlendMode = 1, MultiplyBlendMode = 2, MaxBlendMode = 3 };
+
+// stack of full frame rgb888 layers blended bottom to top into the matrix (one row at a time)
+class Compositor
+{
+public:
+	Compositor(int width, int height, int layer_count);
+	~Compositor();
+
+	void ClearLayer(int index);
+	void Compose(GridTransformer* target);
+	int GetHeight() const
+	{
+		return this->height;
+	}
+	uint8_t* GetLayer(int index)
+	{
+		return this->layers[index].rgb;
+	}
+	int GetWidth() const
+	{
+		return this->width;
+	}
+	void SetBlendMode(int index, BlendModes mode);
+	// over only: pixels with every channel below the key are transparent
+	void SetKey(int index, int key);
+	void SetVisible(int index, bool visible);
+
+private:
+	struct Layer
+	{
+		uint8_t* rgb;
+		BlendModes mode;
+		int key;
+		bool visible;
+	};
+	int width;
+	int height;
+	std::vector<Layer> layers;
+	// blended row handed to the target
+	uint8_t* rowBuffer;
+
+	void Blend(uint8_t* dst, const uint8_t* src, const Layer& layer);
+};
@@ -17,6 +17,117 @@ Config::Config(const string& filename)
 		const char * device_str = root["audio_device"];
 		this->audioDevice = std::string(device_str);
 		fprintf(stderr, "Audo Device: %s\n", this->audioDevice.c_str());
+		// audio source (optional, live capture by default)
+		this->audioSource = ALSAAudioSourceType;
+		std::string audio_source;
+		if (root.lookupValue("audio_source", audio_source))
+		{
+			if (audio_source == "file")
+				this->audioSource = FileAudioSourceType;
+			else if (audio_source == "synthetic")
+				this->audioSource = SyntheticAudioSourceType;
+			else if (audio_source != "alsa")
+				throw invalid_argument("audio_source must be one of \"alsa\", \"file\" or \"synthetic\"!");
+		}
+		root.lookupValue("audio_file", this->audioFile);
+		if (this->audioSource == FileAudioSourceType && this->audioFile.empty())
+			throw invalid_argument("audio_file is required when audio_source is \"file\"!");
+		// replay pacing (real time, or as fast as the analysis thread consumes it)
+		this->audioRealTime = true;
+		root.lookupValue("audio_real_time", this->audioRealTime);
+		// synthetic signal (optional)
+		this->syntheticSignal = ToneSyntheticSignalType;
+		std::string synthetic_signal;
+		if (root.lookupValue("synthetic_signal", synthetic_signal))
+		{
+			if (synthetic_signal == "sweep")
+				this->syntheticSignal = SweepSyntheticSignalType;
+			else if (synthetic_signal == "noise")
+				this->syntheticSignal = NoiseSyntheticSignalType;
+			else if (synthetic_signal == "clicks")
+				this->syntheticSignal = ClickSyntheticSignalType;
+			else if (synthetic_signal != "tone")
+				throw invalid_argument("synthetic_signal must be one of \"tone\", \"sweep\", \"noise\" or \"clicks\"!");
+		}
+		this->syntheticFrequency = 440.0;
+		this->syntheticEndFrequency = 5000.0;
+		this->syntheticAmplitude = 0.5;
+		this->audioDuration = 0.0;
+		root.lookupValue("synthetic_frequency", this->syntheticFrequency);
+		root.lookupValue("synthetic_end_frequency", this->syntheticEndFrequency);
+		root.lookupValue("synthetic_amplitude", this->syntheticAmplitude);
+		root.lookupValue("synthetic_duration", this->audioDuration);
+		// audio access mode (optional)
+		this->audioAccess = ReadCaptureAccessType;
+		std::string audio_access;
+		if (root.lookupValue("audio_access", audio_access))
+		{
+			if (audio_access == "mmap")
+				this->audioAccess = MMapCaptureAccessType;
+			else if (audio_access != "read")
+				throw invalid_argument("audio_access must be one of \"read\" or \"mmap\"!");
+		}
+		// audio period/buffer sizes in frames (optional, 0 = device default)
+		this->audioPeriodSize = 0;
+		this->audioBufferSize = 0;
+		root.lookupValue("audio_period_size", this->audioPeriodSize);
+		root.lookupValue("audio_buffer_size", this->audioBufferSize);
+		if (this->audioPeriodSize < 0 || this->audioBufferSize < 0)
+			throw invalid_argument("audio_period_size and audio_buffer_size must not be negative!");
+		// fft backend (optional)
+		this->fftBackend = AutoFFTBackendType;
+		std::string fft_backend;
+		if (root.lookupValue("fft_backend", fft_backend))
+		{
+			if (fft_backend == "gpu")
+				this->fftBackend = GPUFFTBackendType;
+			else if (fft_backend == "cpu")
+				this->fftBackend = CPUFFTBackendType;
+			else if (fft_backend != "auto")
+				throw invalid_argument("fft_backend must be one of \"auto\", \"gpu\" or \"cpu\"!");
+		}
+		// stft hop in samples (optional, 0 = one full fft frame per hop)
+		this->fftHop = 0;
+		root.lookupValue("fft_hop", this->fftHop);
+		if (this->fftHop < 0)
+			throw invalid_argument("fft_hop must not be negative!");
+		// stft window (optional)
+		this->fftWindow = RectangularFFTWindowType;
+		std::string fft_window;
+		if (root.lookupValue("fft_window", fft_window))
+		{
+			if (fft_window == "hann")
+				this->fftWindow = HannFFTWindowType;
+			else if (fft_window == "blackman-harris")
+				this->fftWindow = BlackmanHarrisFFTWindowType;
+			else if (fft_window != "rectangular")
+				throw invalid_argument("fft_window must be one of \"rectangular\", \"hann\" or \"blackman-harris\"!");
+		}
+		// frequency band edges (optional, hz, ascending)
+		if (root.exists("frequency_bands"))
+		{
+			libconfig::Setting& bands_config = root["frequency_bands"];
+			for (int i = 0; i < bands_config.getLength(); ++i)
+			{
+				float edge = bands_config[i];
+				if (i > 0 && edge <= this->frequencyBands.back())
+				{
+					throw invalid_argument("frequency_bands must be in ascending order!");
+				}
+				this->frequencyBands.push_back(edge);
+			}
+			if (this->frequencyBands.size() < 2)
+			{
+				throw invalid_argument("frequency_bands must contain at least two edges!");
+			}
+		}
+		// sigmoid transfer function (optional)
+		this->sigmoidNumerator = SIGMOID_NUMERATOR;
+		this->sigmoidOffset = SIGMOID_OFFSET;
+		this->sigmoidSlope = SIGMOID_SLOPE;
+		root.lookupValue("sigmoid_numerator", this->sigmoidNumerator);
+		root.lookupValue("sigmoid_offset", this->sigmoidOffset);
+		root.lookupValue("sigmoid_slope", this->sigmoidSlope);
 		// dimension configuration values
 		displayWidth = root["display_width"];
 		displayHeight = root["display_height"];
@@ -24,9 +135,87 @@ Config::Config(const string& filename)
 		panelHeight = root["panel_height"];
 		chainLength = root["chain_length"];
 		parallelCount = root["parallel_count"];
+		// where frames go (optional)
+		this->matrixBackend = HardwareMatrixBackendType;
+		std::string matrix_backend;
+		if (root.lookupValue("matrix_backend", matrix_backend))
+		{
+			if (matrix_backend == "virtual")
+				this->matrixBackend = VirtualMatrixBackendType;
+			else if (matrix_backend != "hardware")
+				throw invalid_argument("matrix_backend must be one of \"hardware\" or \"virtual\"!");
+		}
+		// virtual matrix recording (optional)
+		root.lookupValue("virtual_output", this->virtualOutput);
+		this->virtualFormat = PPMVirtualOutputType;
+		std::string virtual_format;
+		if (root.lookupValue("virtual_format", virtual_format))
+		{
+			if (virtual_format == "raw")
+				this->virtualFormat = RawVirtualOutputType;
+			else if (virtual_format != "ppm")
+				throw invalid_argument("virtual_format must be one of \"ppm\" or \"raw\"!");
+		}
 		// led configuration values
 		ledCutoff = root["led_cutoff"];
 		ledMaxBrightness = root["led_max_brightness"];
+		if (ledMaxBrightness < 0 || ledMaxBrightness > 255)
+			throw invalid_argument("led_max_brightness must be between 0 and 255!");
+		// panel brightness when within the power budget (optional, the matrix library default)
+		ledBrightness = 70;
+		root.lookupValue("led_brightness", ledBrightness);
+		if (ledBrightness < 1 || ledBrightness > 100)
+			throw invalid_argument("led_brightness must be between 1 and 100!");
+		// pwm color depth and temporal dither bits below it (optional)
+		pwmBits = 11;
+		root.lookupValue("pwm_bits", pwmBits);
+		if (pwmBits < 1 || pwmBits > 11)
+			throw invalid_argument("pwm_bits must be between 1 and 11!");
+		pwmDitherBits = 0;
+		root.lookupValue("pwm_dither_bits", pwmDitherBits);
+		if (pwmDitherBits < 0 || pwmDitherBits > 4)
+			throw invalid_argument("pwm_dither_bits must be between 0 and 4!");
+		// present every nth refresh (optional)
+		vsyncFraction = 1;
+		root.lookupValue("vsync_fraction", vsyncFraction);
+		if (vsyncFraction < 1)
+			throw invalid_argument("vsync_fraction must be at least 1!");
+		// frames queued for the refresh thread and whether presenting waits for a free one (optional)
+		swapQueueDepth = 1;
+		root.lookupValue("swap_queue_depth", swapQueueDepth);
+		if (swapQueueDepth < 1 || swapQueueDepth > 8)
+			throw invalid_argument("swap_queue_depth must be between 1 and 8!");
+		swapWait = true;
+		root.lookupValue("swap_wait", swapWait);
+		// fixed frame rate (optional, 0 = as fast as vsync allows)
+		targetFPS = 0.0;
+		root.lookupValue("target_fps", targetFPS);
+		if (targetFPS < 0.0)
+			throw invalid_argument("target_fps must not be negative!");
+		// frames the loop may fall behind before missed frames are skipped (optional)
+		maxLateFrames = 2;
+		root.lookupValue("max_late_frames", maxLateFrames);
+		if (maxLateFrames < 0)
+			throw invalid_argument("max_late_frames must not be negative!");
+		// cores for the analysis and render threads (optional, -1 = not pinned)
+		analysisCPU = -1;
+		root.lookupValue("analysis_cpu", analysisCPU);
+		renderCPU = -1;
+		root.lookupValue("render_cpu", renderCPU);
+		// how the bitmap is blended over the effects (optional)
+		this->bitmapBlend = OverBlendMode;
+		std::string bitmap_blend;
+		if (root.lookupValue("bitmap_blend", bitmap_blend))
+		{
+			if (bitmap_blend == "add")
+				this->bitmapBlend = AddBlendMode;
+			else if (bitmap_blend == "multiply")
+				this->bitmapBlend = MultiplyBlendMode;
+			else if (bitmap_blend == "max")
+				this->bitmapBlend = MaxBlendMode;
+			else if (bitmap_blend != "over")
+				throw invalid_argument("bitmap_blend must be one of \"over\", \"add\", \"multiply\" or \"max\"!");
+		}
 		// Do basic validation of configuration.
 		if (displayWidth % panelWidth != 0)
 		{
@@ -9,7 +9,15 @@
 
 #include <libconfig.h++>
 
+#include "Compositor.h"
+#include "FFT.h"
+#include "FFTBackend.h"
 #include "GridTransformer.h"
+#include "MatrixBackend.h"
+#include "Microphone.h"
+#include "SyntheticAudioSource.h"
+#include "TransferFunction.h"
+#include "VirtualMatrix.h"
 
 class Config
 {
@@ -17,16 +25,105 @@ public:
 	Config(const std::string& filename);
 	~Config();
 
+	int GetAnalysisCPU() const
+	{
+		return this->analysisCPU;
+	}
 	float GetAnimationDuration(int set_index) const
 	{
 		return this->animationDurations[set_index];
 	}
 
+	CaptureAccessTypes GetAudioAccess() const
+	{
+		return this->audioAccess;
+	}
+
+	int GetAudioBufferSize() const
+	{
+		return this->audioBufferSize;
+	}
+
 	std::string GetAudioDevice() const
 	{
 		return this->audioDevice;
 	}
 
+	float GetAudioDuration() const
+	{
+		return this->audioDuration;
+	}
+
+	std::string GetAudioFile() const
+	{
+		return this->audioFile;
+	}
+
+	int GetAudioPeriodSize() const
+	{
+		return this->audioPeriodSize;
+	}
+
+	bool GetAudioRealTime() const
+	{
+		return this->audioRealTime;
+	}
+
+	AudioSourceTypes GetAudioSource() const
+	{
+		return this->audioSource;
+	}
+
+	FFTBackendTypes GetFFTBackend() const
+	{
+		return this->fftBackend;
+	}
+
+	int GetFFTHop() const
+	{
+		return this->fftHop;
+	}
+
+	FFTWindowTypes GetFFTWindow() const
+	{
+		return this->fftWindow;
+	}
+
+	std::vector<float> GetFrequencyBands() const
+	{
+		return this->frequencyBands;
+	}
+
+	float GetSyntheticAmplitude() const
+	{
+		return this->syntheticAmplitude;
+	}
+	float GetSyntheticEndFrequency() const
+	{
+		return this->syntheticEndFrequency;
+	}
+	float GetSyntheticFrequency() const
+	{
+		return this->syntheticFrequency;
+	}
+	SyntheticSignalTypes GetSyntheticSignal() const
+	{
+		return this->syntheticSignal;
+	}
+
+	double GetSigmoidNumerator() const
+	{
+		return this->sigmoidNumerator;
+	}
+	double GetSigmoidOffset() const
+	{
+		return this->sigmoidOffset;
+	}
+	double GetSigmoidSlope() const
+	{
+		return this->sigmoidSlope;
+	}
+
 	int GetDisplayWidth() const
 	{
 		return this->displayWidth;
@@ -39,10 +136,18 @@ public:
 	{
 		return this->ledCutoff;
 	}
+	int GetLEDBrightness() const
+	{
+		return this->ledBrightness;
+	}
 	int GetLEDMaxBrightness() const
 	{
 		return this->ledMaxBrightness;
 	}
+	MatrixBackendTypes GetMatrixBackend() const
+	{
+		return this->matrixBackend;
+	}
 	int GetPanelWidth() const
 	{
 		return this->panelWidth;
@@ -51,6 +156,10 @@ public:
 	{
 		return this->panelHeight;
 	}
+	BlendModes GetBitmapBlend() const
+	{
+		return this->bitmapBlend;
+	}
 	int GetChainLength() const
 	{
 		return this->chainLength;
@@ -75,6 +184,46 @@ public:
 	{
 		return this->parallelCount;
 	}
+	int GetPWMBits() const
+	{
+		return this->pwmBits;
+	}
+	int GetPWMDitherBits() const
+	{
+		return this->pwmDitherBits;
+	}
+	int GetSwapQueueDepth() const
+	{
+		return this->swapQueueDepth;
+	}
+	bool GetSwapWait() const
+	{
+		return this->swapWait;
+	}
+	float GetTargetFPS() const
+	{
+		return this->targetFPS;
+	}
+	int GetMaxLateFrames() const
+	{
+		return this->maxLateFrames;
+	}
+	int GetRenderCPU() const
+	{
+		return this->renderCPU;
+	}
+	VirtualOutputTypes GetVirtualFormat() const
+	{
+		return this->virtualFormat;
+	}
+	std::string GetVirtualOutput() const
+	{
+		return this->virtualOutput;
+	}
+	int GetVSyncFraction() const
+	{
+		return this->vsyncFraction;
+	}
 	std::vector<GridTransformer::Panel> GetPanels() const
 	{
 		return this->panels;
@@ -91,8 +240,40 @@ private:
 		parallelCount,
 		ledCutoff,
 		ledMaxBrightness,
+		ledBrightness,
+		pwmBits,
+		pwmDitherBits,
+		vsyncFraction,
+		swapQueueDepth,
+		maxLateFrames,
+		analysisCPU,
+		renderCPU,
 		imageSetDuration;
+	float targetFPS;
+	bool swapWait;
+	BlendModes bitmapBlend;
+	MatrixBackendTypes matrixBackend;
+	std::string virtualOutput;
+	VirtualOutputTypes virtualFormat;
 	std::string audioDevice;
+	std::string audioFile;
+	AudioSourceTypes audioSource;
+	bool audioRealTime;
+	float audioDuration;
+	SyntheticSignalTypes syntheticSignal;
+	float syntheticFrequency,
+		syntheticEndFrequency,
+		syntheticAmplitude;
+	CaptureAccessTypes audioAccess;
+	int audioPeriodSize,
+		audioBufferSize;
+	FFTBackendTypes fftBackend;
+	int fftHop;
+	FFTWindowTypes fftWindow;
+	std::vector<float> frequencyBands;
+	double sigmoidNumerator,
+		sigmoidOffset,
+		sigmoidSlope;
 	std::vector<float> animationDurations;
 	std::vector<GridTransformer::Panel> panels;
 	std::vector<std::vector<std::string>*> imageSets;
@@ -0,0 +1,89 @@
+#include "DirtyTracker.h"
+
+using namespace rgb_matrix;
+using namespace std;
+
+DirtyTracker::DirtyTracker(Canvas* canvas, int width, int height)
+{
+	this->canvas = canvas;
+	this->width = width;
+	this->height = height;
+	this->wordsPerRow = (width + DIRTY_WORD_BITS - 1) / DIRTY_WORD_BITS;
+	this->shadow = new uint8_t[3 * width * height];
+	this->lit = new uint64_t[this->wordsPerRow * height];
+	this->Clear();
+	return;
+}
+
+void DirtyTracker::Clear()
+{
+	memset(this->shadow, 0, 3 * this->width * this->height);
+	memset(this->lit, 0, sizeof(uint64_t) * this->wordsPerRow * this->height);
+	this->litTop = this->height;
+	this->litBottom = 0;
+	memset(this->levels, 0, sizeof(this->levels));
+	this->levels[0] = 3 * this->width * this->height;
+	return;
+}
+
+void DirtyTracker::Erase(int x, int y, int count)
+{
+	// span is black on the canvas now (lit row bounds are left to the caller)
+	uint8_t* span = this->shadow + 3 * (y * this->width + x);
+	for (int i = 0; i < 3 * count; i++)
+	{
+		this->levels[span[i]]--;
+	}
+	this->levels[0] += 3 * count;
+	memset(span, 0, 3 * count);
+	uint64_t* row = this->lit + y * this->wordsPerRow;
+	for (int i = x; i < x + count; i++)
+	{
+		row[i / DIRTY_WORD_BITS] &= ~(1ULL << (i % DIRTY_WORD_BITS));
+	}
+	return;
+}
+
+void DirtyTracker::Fill(uint8_t red, uint8_t green, uint8_t blue)
+{
+	if (!(red | green | blue))
+	{
+		this->Clear();
+		return;
+	}
+	for (int i = 0; i < this->width * this->height; i++)
+	{
+		this->shadow[3 * i] = red;
+		this->shadow[3 * i + 1] = green;
+		this->shadow[3 * i + 2] = blue;
+	}
+	// every pixel lit (bits past the row width stay clear)
+	for (int y = 0; y < this->height; y++)
+	{
+		uint64_t* row = this->lit + y * this->wordsPerRow;
+		memset(row, 0xFF, sizeof(uint64_t) * this->wordsPerRow);
+		if (this->width % DIRTY_WORD_BITS)
+			row[this->wordsPerRow - 1] = (1ULL << (this->width % DIRTY_WORD_BITS)) - 1;
+	}
+	this->litTop = 0;
+	this->litBottom = this->height;
+	memset(this->levels, 0, sizeof(this->levels));
+	this->levels[red] += this->width * this->height;
+	this->levels[green] += this->width * this->height;
+	this->levels[blue] += this->width * this->height;
+	return;
+}
+
+void DirtyTracker::SetLitRows(int top, int bottom)
+{
+	this->litTop = top;
+	this->litBottom = bottom;
+	return;
+}
+
+DirtyTracker::~DirtyTracker()
+{
+	delete[] this->shadow;
+	delete[] this->lit;
+	return;
+}
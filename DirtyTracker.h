@@ -0,0 +1,88 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#include "canvas.h"
+
+// bits per bitset word
+#define DIRTY_WORD_BITS 64
+
+// what one target canvas currently shows (as last written through the transformer), so unchanged pixels are never re-emitted
+class DirtyTracker
+{
+public:
+	DirtyTracker(rgb_matrix::Canvas* canvas, int width, int height);
+	~DirtyTracker();
+
+	void Clear();
+	void Erase(int x, int y, int count);
+	void Fill(uint8_t red, uint8_t green, uint8_t blue);
+	rgb_matrix::Canvas* GetCanvas() const
+	{
+		return this->canvas;
+	}
+	// how many channels the canvas shows at each value (power estimate, kept up to date by every change)
+	const uint32_t* GetLevels() const
+	{
+		return this->levels;
+	}
+	// rows [top, bottom) holding lit pixels
+	int GetLitBottom() const
+	{
+		return this->litBottom;
+	}
+	uint64_t* GetLitRow(int y)
+	{
+		return this->lit + y * this->wordsPerRow;
+	}
+	const uint8_t* GetRow(int y) const
+	{
+		return this->shadow + 3 * y * this->width;
+	}
+	int GetLitTop() const
+	{
+		return this->litTop;
+	}
+	void SetLitRows(int top, int bottom);
+	// record a pixel color, false if the canvas already shows it
+	bool Update(int x, int y, const uint8_t* rgb)
+	{
+		uint8_t* shadow = this->shadow + 3 * (y * this->width + x);
+		if (shadow[0] == rgb[0] && shadow[1] == rgb[1] && shadow[2] == rgb[2])
+			return false;
+		this->levels[shadow[0]]--;
+		this->levels[shadow[1]]--;
+		this->levels[shadow[2]]--;
+		this->levels[rgb[0]]++;
+		this->levels[rgb[1]]++;
+		this->levels[rgb[2]]++;
+		memcpy(shadow, rgb, 3);
+		uint64_t bit = 1ULL << (x % DIRTY_WORD_BITS);
+		uint64_t* word = this->lit + y * this->wordsPerRow + x / DIRTY_WORD_BITS;
+		if (rgb[0] | rgb[1] | rgb[2])
+		{
+			*word |= bit;
+			this->litTop = y < this->litTop ? y : this->litTop;
+			this->litBottom = y >= this->litBottom ? y + 1 : this->litBottom;
+		}
+		else
+		{
+			*word &= ~bit;
+		}
+		return true;
+	}
+
+private:
+	rgb_matrix::Canvas* canvas;
+	int width;
+	int height;
+	int wordsPerRow;
+	// last written color of every logical pixel and a bitset of the non-black ones
+	uint8_t* shadow;
+	uint64_t* lit;
+	int litTop;
+	int litBottom;
+	// histogram of the channel values in shadow
+	uint32_t levels[256];
+};
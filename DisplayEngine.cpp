@@ -5,12 +5,16 @@ DisplayEngine::DisplayEngine(Config& config)
 {
 	// flag as not running
 	this->running = false;
+	this->analyzing = false;
+	this->analysisThread = NULL;
 
 	// initialize helper classes
 	this->InitializeBitmaps(config);
-	this->InitializeAudioDevice(config.GetAudioDevice());
-	this->InitializeFFT();
+	this->InitializeAudioSource(config);
+	this->InitializeFFT(config);
 	this->InitializeMatrix(config);
+	this->analysisCPU = config.GetAnalysisCPU();
+	this->renderCPU = config.GetRenderCPU();
 	fprintf(stderr, "Done Initializing Display Engine\n");
 	return;
 }
@@ -19,17 +23,92 @@ DisplayEngine::~DisplayEngine()
 {
 	fprintf(stderr, "Entering Display Engine destructor...");
 	delete this->bitmaps;
-	delete this->microphone;
+	delete this->audio;
 	delete this->fft;
+	delete this->stft;
+	delete this->compositor;
+	delete this->scheduler;
+	delete this->limiter;
 	delete this->matrix;
 	delete this->canvas;
 	return;
 }
 
-void DisplayEngine::InitializeAudioDevice(std::string device)
+void DisplayEngine::Analyze()
 {
-	fprintf(stderr, "Initializing audio device...\n");
-	this->microphone = new Microphone(device);
+	this->PinThread(this->analysisCPU);
+
+	// create buffers (one hop of new samples per cycle)
+	int buffer_size = this->stft->GetHop();
+	short buf[buffer_size];
+	// wait half a hop when no audio is ready
+	struct timespec idle = { 0, (long)(500000000LL * buffer_size / SAMP_RATE) };
+	// audio time covered by one hop, so a drained backlog doesn't collapse into a single instant
+	float hop_seconds = (float)buffer_size / SAMP_RATE;
+	float seconds = 0.0;
+	FFTEvents event = NoneFFTEvent;
+	unsigned long event_sequence = 0;
+
+	while (this->analyzing.load())
+	{
+		// never step back behind the hops already timed
+		seconds = fmax(seconds, this->scheduler->GetSeconds());
+
+		// drop any capture backlog beyond one fft frame (analysis fell behind)
+		this->audio->Discard(this->stft->GetSize());
+
+		// process every hop captured so far, keeping any event a cycle raises
+		bool capturing = this->audio->IsCapturing();
+		BinHistory* bins = NULL;
+		while (this->audio->Read(buf, buffer_size))
+		{
+			short* frame = this->stft->Push(buf);
+			bins = this->fft->Cycle(frame, this->binDepth, seconds);
+			seconds += hop_seconds;
+			FFTEvents new_event = this->fft->GetEvents();
+			if (new_event != NoneFFTEvent)
+			{
+				event = new_event;
+				event_sequence++;
+			}
+		}
+
+		// hand the newest results to the render loop
+		if (bins != NULL || !capturing)
+		{
+			AnalysisSnapshot& snapshot = this->snapshots.GetBack();
+			this->fft->GetColorGains(snapshot.redGain, snapshot.greenGain, snapshot.blueGain);
+			snapshot.event = event;
+			snapshot.eventSequence = event_sequence;
+			snapshot.capturing = capturing;
+			this->snapshots.Publish();
+		}
+		// source ran dry (end of replay or capture failure)
+		if (!capturing)
+			break;
+		if (bins == NULL)
+			nanosleep(&idle, NULL);
+	}
+	return;
+}
+
+void DisplayEngine::InitializeAudioSource(Config& config)
+{
+	fprintf(stderr, "Initializing audio source...\n");
+	switch (config.GetAudioSource())
+	{
+		case FileAudioSourceType:
+			this->audio = new FileAudioSource(config.GetAudioFile(), config.GetAudioRealTime());
+			break;
+		case SyntheticAudioSourceType:
+			this->audio = new SyntheticAudioSource(config.GetSyntheticSignal(), config.GetSyntheticFrequency(), config.GetSyntheticEndFrequency(),
+				config.GetSyntheticAmplitude(), config.GetAudioDuration(), config.GetAudioRealTime());
+			break;
+		default:
+		case ALSAAudioSourceType:
+			this->audio = new Microphone(config.GetAudioDevice(), config.GetAudioAccess(), config.GetAudioPeriodSize(), config.GetAudioBufferSize());
+			break;
+	}
 	return;
 }
 
@@ -49,11 +128,22 @@ void DisplayEngine::InitializeBitmaps(Config& config)
 	return;
 }
 
-void DisplayEngine::InitializeFFT()
+void DisplayEngine::InitializeFFT(Config& config)
 {
 	fprintf(stderr, "Initializing FFT processor...\n");
-		this->fft = new FFT(FFT_LOG, SAMP_RATE);
-	this->fft->Create(BIN_COUNT, TOTAL_BIN_DEPTH);
+	// overlapping frames, one spectrum per hop
+	int hop = config.GetFFTHop();
+	this->stft = new STFT(FFT_LOG, hop > 0 ? hop : 1 << FFT_LOG);
+	// histories count spectra, keep them covering the same time as without overlap
+	int overlap = this->stft->GetSize() / this->stft->GetHop();
+	this->binDepth = BIN_DEPTH * overlap;
+	this->fft = new FFT(FFT_LOG, SAMP_RATE, config.GetFFTBackend());
+	vector<float> bands = config.GetFrequencyBands();
+	this->fft->Create(bands.empty() ? BIN_COUNT : bands.size() - 1, TOTAL_BIN_DEPTH * overlap);
+	if (!bands.empty())
+		this->fft->SetBandEdges(bands);
+	this->fft->SetSigmoid(config.GetSigmoidNumerator(), config.GetSigmoidOffset(), config.GetSigmoidSlope());
+	this->fft->SetWindow(config.GetFFTWindow());
 	return;
 }
 
@@ -68,12 +158,36 @@ void DisplayEngine::InitializeMatrix(Config& config)
 	int display_width = config.GetDisplayWidth();
 	int display_height = config.GetDisplayHeight();
 
-	// initialize LED matrix
-	this->canvas = new RGBMatrix(height, chain_length, parallel_count);
-	this->matrix = new GridTransformer(display_width, display_height, width, height, chain_length, config.GetPanels(), canvas);
-	this->matrix->SetCutoff(config.GetLEDCutoff());
-	this->matrix->SetMaxBrightness(config.GetLEDMaxBrightness());
-	this->matrix->Fill(0, 0, 0);
+	// initialize LED matrix (or its in-memory stand-in, same physical layout)
+	switch (config.GetMatrixBackend())
+	{
+		case VirtualMatrixBackendType:
+			this->canvas = new VirtualMatrix(chain_length * width, parallel_count * height, config.GetVirtualOutput(), config.GetVirtualFormat());
+			break;
+		default:
+		case HardwareMatrixBackendType:
+			this->canvas = new HardwareMatrix(height, chain_length, parallel_count, config.GetPWMBits(), config.GetPWMDitherBits(), config.GetSwapQueueDepth());
+			break;
+	}
+	fprintf(stderr, "Using %s LED matrix\n", this->canvas->GetName());
+	// draw offscreen, present on vsync
+	this->offscreen = this->canvas->GetOffscreen();
+	this->vsyncFraction = config.GetVSyncFraction();
+	this->swapWait = config.GetSwapWait();
+	this->droppedFrames = 0;
+	// keep the power of each frame within what a full white frame at led_max_brightness draws
+	this->limiter = new PowerLimiter(config.GetLEDMaxBrightness(), config.GetLEDBrightness());
+	this->canvas->SetBrightness(this->limiter->GetBrightness());
+	this->matrix = new GridTransformer(display_width, display_height, width, height, chain_length, config.GetPanels(), this->offscreen);
+	this->matrix->ResetScreen();
+	// effects, bitmap and text are drawn into layers and blended before upload (dark bitmap pixels are keyed out there)
+	this->matrix->EnableCutoff(false);
+	this->compositor = new Compositor(display_width, display_height, DISPLAY_LAYER_COUNT);
+	this->compositor->SetBlendMode(BitmapDisplayLayer, config.GetBitmapBlend());
+	this->compositor->SetKey(BitmapDisplayLayer, config.GetLEDCutoff());
+	this->compositor->SetKey(TextDisplayLayer, 1);
+	// pace frames on wall time
+	this->scheduler = new FrameScheduler(config.GetTargetFPS(), config.GetMaxLateFrames());
 	return;
 }
 
@@ -82,19 +196,28 @@ void DisplayEngine::PrintBitmap(Bitmap* bitmap, float red_gain, float green_gain
 	// retrieve data array
 	unsigned char* data = bitmap->GetData();
 
-	// iterate through each pixel in the bitmap
-	for (int x = 0; x<bitmap->GetWidth(); x++)
+	// draw into the bitmap layer (mirror y)
+	int width = bitmap->GetWidth();
+	int layer_width = this->compositor->GetWidth();
+	int height = bitmap->GetHeight();
+	if (width > layer_width || height > this->compositor->GetHeight())
+		throw invalid_argument("Bitmap is larger than the display");
+	// anything the bitmap does not cover stays transparent
+	if (width < layer_width || height < this->compositor->GetHeight())
+		this->compositor->ClearLayer(BitmapDisplayLayer);
+	uint8_t* layer = this->compositor->GetLayer(BitmapDisplayLayer);
+	for (int y = 0; y<height; y++)
 	{
-		for (int y = 0; y<bitmap->GetHeight(); y++)
+		uint8_t* row = layer + 3 * y * layer_width;
+		for (int x = 0; x<width; x++)
 		{
 			// calculate index into single dimensional array of pixel data
-			int index = y * bitmap->GetWidth() * 3 + x * 3;
+			int index = y * width * 3 + x * 3;
 			// calculate color
-			int r = (float)data[index] * red_gain;
-			int g = (float)data[index + 1] * green_gain;
-			int b = (float)data[index + 2] * blue_gain;
-			// draw (mirror y)
-			this->matrix->SetPixel(bitmap->GetWidth() - x - 1, y, r, g, b);
+			uint8_t* pixel = row + 3 * (width - x - 1);
+			pixel[0] = (int)((float)data[index] * red_gain);
+			pixel[1] = (int)((float)data[index + 1] * green_gain);
+			pixel[2] = (int)((float)data[index + 2] * blue_gain);
 		}
 	}
 	return;
@@ -102,9 +225,6 @@ void DisplayEngine::PrintBitmap(Bitmap* bitmap, float red_gain, float green_gain
 
 void DisplayEngine::PrintBorder(float seconds, float red_gain, float green_gain, float blue_gain)
 {
-	// disable minimum brightness cutoff
-	this->matrix->EnableCutoff(false);
-
 	// determine circle time (circle constantly shrinks but resets every second)
 	float duration = 1.0;
 	if (seconds - this->contractingCircleReset > duration)
@@ -113,26 +233,30 @@ void DisplayEngine::PrintBorder(float seconds, float red_gain, float green_gain,
 	}
 	float ratio = duration - (seconds - this->contractingCircleReset);
 
-	// print horizontal border lines
-	for (int x = 0; x < this->matrix->width(); x++)
+	// draw into the effect layer
+	int width = this->compositor->GetWidth();
+	uint8_t* layer = this->compositor->GetLayer(EffectDisplayLayer);
+	for (int y = 0; y < this->compositor->GetHeight(); y++)
 	{
-		// print vertical border lines
-		for (int y = 0; y < this->matrix->height(); y++)
+		uint8_t* row = layer + 3 * y * width;
+		for (int x = 0; x < width; x++)
 		{
-			int x_dist = (int)((float)(x - this->matrix->width() / 2) * ratio);
-			int y_dist = (int)((float)(y - this->matrix->height() / 2) * ratio);
+			int x_dist = (int)((float)(x - width / 2) * ratio);
+			int y_dist = (int)((float)(y - this->compositor->GetHeight() / 2) * ratio);
 			float color_val = (float)fmax(pow(sqrt(pow(x_dist, 2) + pow(y_dist, 2)), 2) / 32 - 10, 0);
-			this->matrix->SetPixel(x, y, (int)(color_val * red_gain), (int)(color_val * green_gain), (int)(color_val * blue_gain));
+			row[3 * x] = (int)(color_val * red_gain);
+			row[3 * x + 1] = (int)(color_val * green_gain);
+			row[3 * x + 2] = (int)(color_val * blue_gain);
 		}
 	}
-
-	// re-enable minimum brightness cutoff
-	this->matrix->EnableCutoff(true);
 	return;
 }
 
 void DisplayEngine::PrintCanvas(int x, int y, const string& text, int r, int g, int b)
 {
+	// draw into the text layer
+	int width = this->compositor->GetWidth();
+	uint8_t* layer = this->compositor->GetLayer(TextDisplayLayer);
 	// iterate through characters of text
 	for (auto c : text)
 	{
@@ -145,8 +269,11 @@ void DisplayEngine::PrintCanvas(int x, int y, const string& text, int r, int g,
 			for (int j = 0; j<8; ++j)
 			{
 				// Put a pixel for each 1 in the column byte.
-				if ((col >> j) & 0x01) {
-					this->matrix->SetPixel(x, y + j, r, g, b);
+				if (((col >> j) & 0x01) && x < width && y + j < this->compositor->GetHeight()) {
+					uint8_t* pixel = layer + 3 * ((y + j) * width + x);
+					pixel[0] = r;
+					pixel[1] = g;
+					pixel[2] = b;
 				}
 			}
 		}
@@ -183,9 +310,6 @@ void DisplayEngine::PrintIdentification()
 
 void DisplayEngine::PrintContractingCircle(float seconds, float red_gain, float green_gain, float blue_gain)
 {
-	// disable minimum brightness cutoff
-	this->matrix->EnableCutoff(false);
-
 	// determine circle time (circle constantly shrinks but resets every second)
 	float duration = 1.0;
 	if(seconds - this->contractingCircleReset > duration)
@@ -194,23 +318,59 @@ void DisplayEngine::PrintContractingCircle(float seconds, float red_gain, float
 	}
 	float ratio = duration - (seconds - this->contractingCircleReset);
 	
-	// print horizontal border lines
-	int half_width = this->matrix->width()/2;
-	int half_height = this->matrix->height()/2;
-	for (int x = 0; x < this->matrix->width(); x++)
+	// draw into the effect layer
+	int width = this->compositor->GetWidth();
+	int half_width = width/2;
+	int half_height = this->compositor->GetHeight()/2;
+	uint8_t* layer = this->compositor->GetLayer(EffectDisplayLayer);
+	for (int y = 0; y < this->compositor->GetHeight(); y++)
 	{
-		// print vertical border lines
-		for (int y = 0; y < this->matrix->height(); y++)
+		uint8_t* row = layer + 3 * y * width;
+		for (int x = 0; x < width; x++)
 		{
 			int x_dist = (int)((float)(half_width - abs(x - half_width)) * ratio);
 			int y_dist = (int)((float)(half_height - abs(y - half_height)) * ratio);
 			float color_val = (float)fmax(pow(sqrt(pow(x_dist, 2) + pow(y_dist, 2)), 2) / 32, 0);
-			this->matrix->SetPixel(x, y, (int)(color_val * red_gain), (int)(color_val * green_gain), (int)(color_val * blue_gain));
+			row[3 * x] = (int)(color_val * red_gain);
+			row[3 * x + 1] = (int)(color_val * green_gain);
+			row[3 * x + 2] = (int)(color_val * blue_gain);
 		}
 	}
+	return;
+}
+
+void DisplayEngine::PinThread(int cpu)
+{
+	// keep the calling thread on one core
+	if (cpu < 0)
+		return;
+	cpu_set_t cpu_mask;
+	CPU_ZERO(&cpu_mask);
+	CPU_SET(cpu, &cpu_mask);
+	if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_mask), &cpu_mask) != 0)
+		fprintf(stderr, "Couldn't pin thread to cpu %d\n", cpu);
+	return;
+}
 
-	// re-enable minimum brightness cutoff
-	this->matrix->EnableCutoff(true);
+void DisplayEngine::Present()
+{
+	// blend the layers into the offscreen canvas
+	this->compositor->Compose(this->matrix);
+	// erase what the frame no longer draws, swap it in on the next vsync and start drawing into the one it replaced
+	// (a dropped frame stays offscreen and the next one is drawn over it)
+	this->matrix->FinishFrame();
+	// the channel levels are tracked as pixels change, pick the brightness of the next frame from them
+	int brightness = this->limiter->Update(this->matrix->GetLevels());
+	Canvas* next = this->swapWait ? this->canvas->Swap(this->vsyncFraction) : this->canvas->TrySwap(this->vsyncFraction);
+	if (next != NULL)
+		this->offscreen = next;
+	else
+		this->droppedFrames++;
+	this->matrix->SetSource(this->offscreen);
+	// brightness only applies to newly set pixels, so a change rewrites what the canvas already shows
+	if (this->canvas->SetBrightness(brightness))
+		this->matrix->Repaint();
+	this->matrix->ResetScreen();
 	return;
 }
 
@@ -219,11 +379,6 @@ void DisplayEngine::Start()
 	fprintf(stderr, "Initializing display loop...\n");
 	// flag as running
 	this->running = true;
-	const clock_t start_time = clock();
-
-	// create buffers
-	int buffer_size = 1 << FFT_LOG;
-	short buf[buffer_size];
 
 	// initialize values
 	int bitmap_set_index = 0;
@@ -233,23 +388,37 @@ void DisplayEngine::Start()
 
 	// print identification
 	this->PrintIdentification();
+	this->Present();
 	sleep(3);
+	this->compositor->ClearLayer(TextDisplayLayer);
+
+	// start capturing and analyzing, render on this thread
+	this->audio->Start();
+	this->scheduler->Start();
+	this->analyzing = true;
+	this->analysisThread = new std::thread(&DisplayEngine::Analyze, this);
+	this->PinThread(this->renderCPU);
+	unsigned long event_sequence = 0;
 
 	// start loop
 	while (this->running)
 	{
-		// get new time
-		float seconds = (float)(clock() - start_time) / (float)CLOCKS_PER_SEC;
-
-		// get microphone data
-		this->microphone->GetData(buf, buffer_size);
-
-		// process data
-		int** bins = this->fft->Cycle(buf, BIN_DEPTH, seconds);
-		this->fft->GetColorGains(red_gain, green_gain, blue_gain);
-
-		// respond to events
-		FFTEvents fft_event = this->fft->GetEvents();
+		// get new time (wall clock, animations and fft events track real time)
+		float seconds = this->scheduler->GetSeconds();
+
+		// newest analysis results (the previous ones are kept until the analysis thread publishes again)
+		this->snapshots.Update();
+		const AnalysisSnapshot& analysis = this->snapshots.GetFront();
+		// source ran dry (end of replay or capture failure)
+		if (!analysis.capturing)
+			this->running = false;
+		red_gain = analysis.redGain;
+		green_gain = analysis.greenGain;
+		blue_gain = analysis.blueGain;
+
+		// respond to events (once each)
+		FFTEvents fft_event = analysis.eventSequence != event_sequence ? analysis.event : NoneFFTEvent;
+		event_sequence = analysis.eventSequence;
 		switch (fft_event)
 		{
 			case DecreasedAmplitudeFFTEvent:
@@ -274,7 +443,8 @@ void DisplayEngine::Start()
 				break;
 		}
 
-		// print to LEDs
+		// print to LEDs (effects only below the bitmap in the amplitude modes)
+		this->compositor->SetVisible(EffectDisplayLayer, mode != BitmapDisplayMode);
 		int image_index = this->bitmaps->GetIndex(bitmap_set_index, seconds);
 		Bitmap* bitmap = this->bitmaps->Get(bitmap_set_index, image_index);
 		switch (mode)
@@ -293,13 +463,22 @@ void DisplayEngine::Start()
 			break;
 		}
 
-		// wait for next loop
-		this->matrix->ResetScreen();
-		usleep(1000);
+		// present and wait for the next frame
+		this->Present();
+		this->scheduler->Wait();
 	}
 
 	// clean-up
-	this->matrix->Clear();
+	this->analyzing = false;
+	this->analysisThread->join();
+	delete this->analysisThread;
+	this->analysisThread = NULL;
+	this->audio->Stop();
+	fprintf(stderr, "Audio source dropped %lu samples (%lu overruns)\n", this->audio->GetDroppedSamples(), this->audio->GetOverruns());
+	this->scheduler->PrintStats();
+	this->limiter->PrintStats();
+	fprintf(stderr, "Matrix dropped %lu frames\n", this->droppedFrames);
+	this->canvas->Clear();
 
 	return;
 }
@@ -1,17 +1,29 @@
 #pragma once
 
 #include "BitmapManager.h"
+#include "Compositor.h"
 #include "Config.h"
 #include "FFT.h"
 #include "glcdfont.h"
 #include "GridTransformer.h"
+#include "HardwareMatrix.h"
+#include "PowerLimiter.h"
+#include "FileAudioSource.h"
+#include "FrameScheduler.h"
 #include "Microphone.h"
+#include "STFT.h"
+#include "SyntheticAudioSource.h"
+#include "TripleBuffer.h"
+#include "VirtualMatrix.h"
 
+#include <atomic>
 #include <cstdint>
 #include <iostream>
 #include <signal.h>
 #include <sstream>
 #include <stdexcept>
+#include <pthread.h>
+#include <thread>
 #include <time.h>
 #include <unistd.h>
 
@@ -28,13 +40,27 @@ using namespace rgb_matrix;
 #define SAMP_RATE 11025
 // # of frequency bins
 #define BIN_COUNT 16
-// history count for each frequency bin (for normalization)
+// history count for each frequency bin (for normalization), in non-overlapping fft frames
 #define TOTAL_BIN_DEPTH 64
-// history count for each frequency bin (for display)
+// history count for each frequency bin (for display), in non-overlapping fft frames
 #define BIN_DEPTH 8
 
 enum DisplayModes { BitmapDisplayMode = 0, LowAmplitudeDisplayMode = 1, HighAmplitudeDisplayMode = 2 };
 
+// newest analysis results, handed from the analysis thread to the render loop
+struct AnalysisSnapshot
+{
+	float redGain = 1.0, greenGain = 1.0, blueGain = 1.0;
+	// latest event and how many events have occurred (events between two renders collapse into the newest)
+	FFTEvents event = NoneFFTEvent;
+	unsigned long eventSequence = 0;
+	bool capturing = true;
+};
+
+// compositor layers, bottom to top
+enum DisplayLayers { EffectDisplayLayer = 0, BitmapDisplayLayer = 1, TextDisplayLayer = 2 };
+#define DISPLAY_LAYER_COUNT 3
+
 class DisplayEngine
 {
 	public:
@@ -44,17 +70,36 @@ class DisplayEngine
 		void Stop();
 	private:
 		BitmapManager* bitmaps;
-		Microphone* microphone;
+		AudioSource* audio;
 		FFT* fft;
-		RGBMatrix* canvas;
+		STFT* stft;
+		// displayed history in spectra (BIN_DEPTH scaled to the hop, so it spans the same time)
+		int binDepth;
+		MatrixBackend* canvas;
+		// frame being drawn while the other one is scanned out
+		Canvas* offscreen;
+		int vsyncFraction;
+		// wait for the panels when presenting (otherwise frames that can't be queued yet are dropped)
+		bool swapWait;
+		unsigned long droppedFrames;
 		GridTransformer* matrix;
+		Compositor* compositor;
+		FrameScheduler* scheduler;
+		PowerLimiter* limiter;
 		bool running;
+		// capture, fft and event detection run on their own thread (cores < 0 are not pinned)
+		std::thread* analysisThread;
+		std::atomic<bool> analyzing;
+		TripleBuffer<AnalysisSnapshot> snapshots;
+		int analysisCPU;
+		int renderCPU;
 		
 		float contractingCircleReset = 0.0;
 
-		void InitializeAudioDevice(std::string device);
+		void Analyze();
+		void InitializeAudioSource(Config& config);
 		void InitializeBitmaps(Config& config);
-		void InitializeFFT();
+		void InitializeFFT(Config& config);
 		void InitializeMatrix(Config& config);
 
 		void PrintBitmap(Bitmap* bitmap, float red_gain, float green_gain, float blue_gain);
@@ -62,4 +107,6 @@ class DisplayEngine
 		void PrintCanvas(int x, int y, const string& message, int r = 255, int g = 255, int b = 255);
 		void PrintContractingCircle(float seconds, float red_gain, float green_gain, float blue_gain);
 		void PrintIdentification();
+		void PinThread(int cpu);
+		void Present();
 };
\ No newline at end of file
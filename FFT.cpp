@@ -2,11 +2,18 @@
 
 using namespace std;
 
-FFT::FFT(int fft_log, int sample_rate)
+// default band edges for 16 bands (hz)
+static const float DefaultBandEdges[] = { 20.0,50.0,100.0,150.0,200.0,250.0,300.0,350.0,400.0,500.0,600.0,750.0,1000.0,2000.0,3000.0,5000.0,7500.0 };
+
+FFT::FFT(int fft_log, int sample_rate, FFTBackendTypes backend, bool real_input)
 {
 	this->binCount = 0;
 	this->binDepth = 0;
 	this->bins = NULL;
+	this->decibelBins = NULL;
+	this->bandEdges = NULL;
+	this->bandStarts = NULL;
+	this->bandEnds = NULL;
 	this->eventResponseOccurred = 0.0;
 	this->normalizedBins = NULL;
 	this->fftEvents = NoneFFTEvent;
@@ -15,17 +22,30 @@ FFT::FFT(int fft_log, int sample_rate)
 	this->fftLog = fft_log;
 	this->eventInvalidated = 0.0;
 	this->sampleRate = sample_rate;
-	this->mailbox = mbox_open();
 	this->minimumStateDuration = 0.00001;
-	int ret = gpu_fft_prepare(this->mailbox, this->fftLog, GPU_FFT_REV, FFT_JOBS, &(this->fft));
+	this->transferFunction = new TransferFunction();
+	this->realInput = real_input;
+	this->realTwiddles = NULL;
+	this->spectrum = NULL;
+	this->window = new float[1 << this->fftLog];
+	this->SetWindow(RectangularFFTWindowType);
+	if (!this->realInput)
+	{
+		this->backend = FFTBackend::Create(backend, this->fftLog, GPU_FFT_REV);
+		return;
+	}
 
-	switch (ret)
+	// real input mode runs a half size transform, then splits it with the post-twiddle
+	this->backend = FFTBackend::Create(backend, this->fftLog - 1, GPU_FFT_REV);
+	int full_count = 1 << this->fftLog;
+	this->realTwiddles = new GPU_FFT_COMPLEX[full_count / 2];
+	this->spectrum = new GPU_FFT_COMPLEX[full_count / 2];
+	for (int k = 0; k < full_count / 2; k++)
 	{
-		case -1: throw runtime_error("Unable to enable V3D. Please check your firmware is up to date.\n");
-		case -2: throw runtime_error("log2_N=%d not supported.  Try between 8 and 22.\n");
-		case -3: throw runtime_error("Out of memory.  Try a smaller batch or increase GPU memory.\n");
-		case -4: throw runtime_error("Unable to map Videocore peripherals into ARM memory space.\n");
-		case -5: throw runtime_error("Can't open libbcm_host.\n");
+		// same (inverse) direction as the backend transform
+		double angle = 2.0 * GPU_FFT_PI * (double)k / (double)full_count;
+		this->realTwiddles[k].re = cos(angle);
+		this->realTwiddles[k].im = sin(angle);
 	}
 	return;
 }
@@ -51,55 +71,98 @@ void FFT::Analyze(int* bins, int count, int& min, int& max, int& avg)
 	return;
 }
 
-void FFT::Archive(int** bins, int count, int depth)
+void FFT::Create(int count, int depth)
 {
-	// iterate through all bin depths
-	for (int i = depth - 1; i>0; i--)
+	this->DeleteBins();
+	this->binCount = count;
+	this->binDepth = depth;
+	this->bins = new BinHistory(count, depth);
+	this->normalizedBins = new BinHistory(count, depth);
+	this->decibelBins = new BinHistory(count, depth);
+	int j = 0;
+	for (j = 0; j<count; j++)
 	{
-		// iterate through all frequencies of a given bin depth
-		for (int j = 0; j<count; j++)
-		{
-			// move new entries (high index) backwards (towards index 0)
-			bins[i][j] = bins[i - 1][j];
-		}
+		this->binMaxs.push_back(new WindowedMax(depth));
 	}
+
+	// default band edges (log spaced up to nyquist if not 16 bands)
+	this->bandEdges = new float[count + 1];
+	this->bandStarts = new int[count];
+	this->bandEnds = new int[count];
+	int default_count = sizeof(DefaultBandEdges) / sizeof(DefaultBandEdges[0]) - 1;
+	float nyquist = (float)this->sampleRate / 2.0;
+	for (j = 0; j <= count; j++)
+	{
+		if (count == default_count)
+			this->bandEdges[j] = DefaultBandEdges[j];
+		else
+			this->bandEdges[j] = MIN_BAND_FREQUENCY * pow(nyquist / MIN_BAND_FREQUENCY, (float)j / (float)count);
+	}
+	this->CreateBandTable();
 	return;
 }
 
-void FFT::Create(int count, int depth)
+void FFT::CreateBandTable()
 {
-	this->DeleteBins();
-	this->binCount = count;
-	this->binDepth = depth;
-	this->bins = new int*[depth];
-	this->normalizedBins = new int*[depth];
+	int full_count = 1 << this->fftLog;
 	int i = 0, j = 0;
-	for (i = 0; i<depth; i++)
+	for (j = 0; j<this->binCount; j++)
 	{
-		this->bins[i] = new int[count];
-		this->normalizedBins[i] = new int[count];
-		for (j = 0; j<count; j++)
+		this->bandStarts[j] = this->bandEnds[j] = 0;
+	}
+	// sort fft bins into bands once; bands are ascending so each one is a contiguous run
+	for (i = 0; i<full_count / 2; i++)
+	{
+		// calculate frequency
+		float frequency = (float)i * ((float)(this->sampleRate) / (float)(full_count));
+		for (j = 0; j<this->binCount; j++)
 		{
-			this->bins[i][j] = this->normalizedBins[i][j] = 0;
+			if (frequency >= this->bandEdges[j] && frequency < this->bandEdges[j + 1])
+			{
+				if (this->bandEnds[j] == this->bandStarts[j])
+					this->bandStarts[j] = i;
+				this->bandEnds[j] = i + 1;
+				break;
+			}
 		}
 	}
 	return;
 }
 
-int** FFT::Cycle(short* data, int display_depth, float seconds)
+BinHistory* FFT::Cycle(short* data, int display_depth, float seconds)
 {
-	// make space for new bin acquisition
-	this->Archive(this->bins, this->binCount, this->binDepth);
+	// make space for new bin acquisition (both histories advance together so their rows line up)
+	int* row = this->bins->Append();
+	this->normalizedBins->Append();
 	// acquire new bin values
-	this->Get(data, this->bins[0], this->binCount, this->sampleRate);
+	this->Get(data, row, this->binCount);
 
-	// normalize bins
+	// only the newest row is new; convert it once and keep it in the db history
 	FFTOptions options = Logarithmic | Autoscale | Sigmoid;
+	int* decibel_row = this->decibelBins->Append();
+	for (int j = 0; j < this->binCount; j++)
+	{
+		// convert to db
+		if ((options & Logarithmic) != 0)
+		{
+			decibel_row[j] = this->transferFunction->Decibels(row[j]);
+		}
+		else
+		{
+			decibel_row[j] = row[j];
+		}
+		// ignore negative values/db
+		decibel_row[j] = fmax(decibel_row[j], 0);
+		// update max for all history of current frequency bin
+		this->binMaxs[j]->Push(decibel_row[j]);
+	}
+
+	// normalize bins
 	int min = 0, max = 0, avg = 0;
-	this->Normalize(this->bins, this->normalizedBins, this->binCount, display_depth, this->binDepth, options);
+	this->Normalize(this->normalizedBins, display_depth, options);
 
 	// perform analysis and detect events
-	this->Analyze(this->normalizedBins[0], this->binCount, min, max, avg);
+	this->Analyze(this->normalizedBins->Get(0), this->binCount, min, max, avg);
 	FFTEventStates new_event_state = this->DetectEventState(min, max, avg, seconds);
 	FFTEvents new_event = this->DetectEventTransition(this->fftEventState, new_event_state);
 	this->fftEvents = new_event;
@@ -109,15 +172,23 @@ int** FFT::Cycle(short* data, int display_depth, float seconds)
 
 void FFT::DeleteBins()
 {
-	for (int i = 0; i < this->binDepth; i++)
-	{
-		delete this->bins[i];
-		delete this->normalizedBins[i];
-	}
 	delete this->bins;
 	delete this->normalizedBins;
+	delete this->decibelBins;
+	for (unsigned int j = 0; j < this->binMaxs.size(); j++)
+	{
+		delete this->binMaxs[j];
+	}
+	this->binMaxs.clear();
+	delete[] this->bandEdges;
+	delete[] this->bandStarts;
+	delete[] this->bandEnds;
 	this->bins = NULL;
 	this->normalizedBins = NULL;
+	this->decibelBins = NULL;
+	this->bandEdges = NULL;
+	this->bandStarts = NULL;
+	this->bandEnds = NULL;
 	this->binCount = 0;
 	this->binDepth = 0;
 	return;
@@ -223,50 +294,20 @@ FFTEvents FFT::DetectEventTransition(FFTEventStates old_state, FFTEventStates ne
 	return value;
 }
 
-void FFT::Get(short* buffer, int* bins, int bin_count, int sample_rate)
+void FFT::Get(short* buffer, int* bins, int bin_count)
 {
-	// initialize parameters
-	int full_count = 1 << this->fftLog;
-	float frequencies[bin_count + 1] = { 20.0,50.0,100.0,150.0,200.0,250.0,300.0,350.0,400.0,500.0,600.0,750.0,1000.0,2000.0,3000.0,5000.0,7500.0 };
-	float maxs[bin_count];
-	float max = 0.0;
-	float value = 0.0;
-	int i = 0, j = 0;
-
-	// assign fft input
-	for (i = 0; i<full_count; i++)
-	{
-		fft->in[i].re = (float)buffer[i];
-		fft->in[i].im = 0.0;
-	}
-	// reset maxs
-	for (j = 0; j<bin_count; j++)
-	{
-		maxs[j] = 0.0;
-	}
-
 	// execute fft
-	gpu_fft_execute(this->fft); // call one or many times
+	GPU_FFT_COMPLEX* out = this->Transform(buffer);
 
-	// calculate results
-	for (i = 0; i<full_count / 2; i++)
+	// reduce each band's run of fft bins to its peak (segmented max, no per-bin search)
+	for (int j = 0; j<bin_count; j++)
 	{
-		// calculate frequency
-		float frequency = (float)i * ((float)(sample_rate) / (float)(full_count));
-		// iterate through frequency bins
-		// sort results into discrete frequency bins
-		for (j = 0; j<bin_count; j++)
+		float max = 0.0;
+		for (int i = this->bandStarts[j]; i<this->bandEnds[j]; i++)
 		{
-			if (frequency >= frequencies[j] && frequency < frequencies[j + 1])
-			{
-				// calculate result vector
-				value = this->fft->out[i].re;
-				maxs[j] = fmax(maxs[j], value);
-				bins[j] = (int)maxs[j];
-				max = fmax(maxs[j], max);
-				break;
-			}
+			max = fmax(max, out[i].re);
 		}
+		bins[j] = (int)max;
 	}
 	return;
 }
@@ -286,36 +327,17 @@ FFTEvents FFT::GetEvents()
 	return value;
 }
 
-void FFT::Normalize(int** bins, int** normalized_bins, int count, int depth, int total_depth, FFTOptions options)
+void FFT::Normalize(BinHistory* normalized_bins, int depth, FFTOptions options)
 {
 	// initialize parameters
+	int count = this->binCount;
 	int i = 0, j = 0;
 	int full_min = 999999999, full_max = -999999999;
-	// calculate highest and lowest peaks of a given frequency bin
 	for (j = 0; j<count; j++)
 	{
-		// reset current frequency bin max
-		int bin_max = 0;
-		// iterate through all bin history (even not displayed ones)
-		for (i = 0; i<total_depth; i++)
-		{
-			
-			// convert to db
-			if ((options & Logarithmic) != 0)
-			{
-				normalized_bins[i][j] = 20.0 * log10(bins[i][j]);
-			}
-			else
-			{
-				normalized_bins[i][j] = bins[i][j];
-			}
-			// ignore negative values/db
-			normalized_bins[i][j] = fmax(normalized_bins[i][j], 0);
-			// calculate max for all history of current frequency bin
-			bin_max = fmax(bin_max, normalized_bins[i][j]);
-			// calculate max for all history of all frequency bins
-			full_max = fmax(full_max, normalized_bins[i][j]);
-		}
+		int bin_max = this->binMaxs[j]->Get();
+		// calculate max for all history of all frequency bins
+		full_max = fmax(full_max, bin_max);
 		// calculate smallest peak occurring to any given frequency bin over all history
 		full_min = fmin(full_min, bin_max);
 	}
@@ -328,29 +350,32 @@ void FFT::Normalize(int** bins, int** normalized_bins, int count, int depth, int
 	{
 		// calculate gain decay (based on age)
 		float decay = (float)(depth - i) / (float)depth;
+		int* decibel_row = this->decibelBins->Get(i);
+		int* normalized_row = normalized_bins->Get(i);
 
 		// iterate through freq bins of a given depth
 		for (j = 0; j<count; j++)
 		{
+			normalized_row[j] = decibel_row[j];
 			// autoscale
 			if ((options & Autoscale) != 0)
 			{
 				// calculate ratio (0.0 -> 1.0)
-				float ratio = (float)(normalized_bins[i][j] - full_min) / (float)range;
+				float ratio = (float)(normalized_row[j] - full_min) / (float)range;
 				// cull negative values (i.e. amplitudes which are underrange)
 				ratio = fmax(ratio, 0.0);
 				//fprintf(stderr, "Ratio: %f\n", ratio);
-				normalized_bins[i][j] = FULL_SCALE * ratio;
+				normalized_row[j] = FULL_SCALE * ratio;
 			}
 
 			// apply sigmoid approximation (emphasize peaks and scale 0.0-100.0)
 			if ((options & Sigmoid) != 0)
 			{
-				normalized_bins[i][j] = SigmoidFunction((double)normalized_bins[i][j]);
+				normalized_row[j] = this->transferFunction->Sigmoid(normalized_row[j]);
 			}
 
 			// calculate base gain (based on bin amplitude) (0.0 -> 2.0)
-			float bin_gain = (float)normalized_bins[i][j] / (FULL_SCALE / 2.0);
+			float bin_gain = (float)normalized_row[j] / (FULL_SCALE / 2.0);
 			// increases with bin frequency (0.1 -> 1.0)
 			blue_gain = fmax(bin_gain * ((float)(j + 1) / (float)count)*decay, blue_gain);
 			// increases towards center frequency (0.1 -> 1.0 -> 0.1)
@@ -367,17 +392,107 @@ void FFT::Normalize(int** bins, int** normalized_bins, int count, int depth, int
 	return;
 }
 
-double FFT::SigmoidFunction(double value)
+void FFT::SetBandEdges(const vector<float>& edges)
 {
-	/* in order to approach a desired full scale value, the left-hand side constant (in the demoninator)
-	needs to be equal to the numerator divided by the desired full scale */
-	double constant = SIGMOID_NUMERATOR / FULL_SCALE;
-	return SIGMOID_NUMERATOR / (constant + pow(M_E, -1.0*((value - SIGMOID_OFFSET) / SIGMOID_SLOPE)));
+	if ((int)edges.size() != this->binCount + 1)
+		throw invalid_argument("Band edge count must be one more than the bin count");
+	for (int j = 0; j <= this->binCount; j++)
+	{
+		this->bandEdges[j] = edges[j];
+	}
+	this->CreateBandTable();
+	return;
+}
+
+void FFT::SetSigmoid(double numerator, double offset, double slope)
+{
+	this->transferFunction->SetSigmoid(numerator, offset, slope);
+	return;
+}
+
+void FFT::SetWindow(FFTWindowTypes type)
+{
+	int full_count = 1 << this->fftLog;
+	double sum = 0.0;
+	for (int i = 0; i < full_count; i++)
+	{
+		// periodic windows (overlapping frames sum to a constant)
+		double phase = 2.0 * GPU_FFT_PI * (double)i / (double)full_count;
+		switch (type)
+		{
+			case HannFFTWindowType:
+				this->window[i] = 0.5 - 0.5 * cos(phase);
+				break;
+			case BlackmanHarrisFFTWindowType:
+				this->window[i] = 0.35875 - 0.48829 * cos(phase) + 0.14128 * cos(2.0 * phase) - 0.01168 * cos(3.0 * phase);
+				break;
+			default:
+			case RectangularFFTWindowType:
+				this->window[i] = 1.0;
+				break;
+		}
+		sum += this->window[i];
+	}
+	// compensate coherent gain so band levels stay comparable between windows
+	for (int i = 0; i < full_count; i++)
+	{
+		this->window[i] *= (double)full_count / sum;
+	}
+	return;
+}
+
+GPU_FFT_COMPLEX* FFT::Transform(short* buffer)
+{
+	// initialize parameters
+	int full_count = 1 << this->fftLog;
+	int half_count = full_count / 2;
+	GPU_FFT_COMPLEX* in = this->backend->GetInput();
+	GPU_FFT_COMPLEX* out = this->backend->GetOutput();
+	int i = 0;
+
+	if (!this->realInput)
+	{
+		// assign fft input
+		for (i = 0; i<full_count; i++)
+		{
+			in[i].re = (float)buffer[i] * this->window[i];
+			in[i].im = 0.0;
+		}
+		this->backend->Execute();
+		return out;
+	}
+
+	// pack even samples into the real part and odd samples into the imaginary part
+	for (i = 0; i<half_count; i++)
+	{
+		in[i].re = (float)buffer[2 * i] * this->window[2 * i];
+		in[i].im = (float)buffer[2 * i + 1] * this->window[2 * i + 1];
+	}
+	this->backend->Execute();
+
+	// post-twiddle: separate even/odd spectra (hermitian symmetry) and combine them
+	for (i = 0; i<half_count; i++)
+	{
+		GPU_FFT_COMPLEX a = out[i];
+		GPU_FFT_COMPLEX b = out[(half_count - i) & (half_count - 1)];
+		float even_re = 0.5 * (a.re + b.re);
+		float even_im = 0.5 * (a.im - b.im);
+		float odd_re = 0.5 * (a.im + b.im);
+		float odd_im = -0.5 * (a.re - b.re);
+		GPU_FFT_COMPLEX w = this->realTwiddles[i];
+		this->spectrum[i].re = even_re + w.re * odd_re - w.im * odd_im;
+		this->spectrum[i].im = even_im + w.re * odd_im + w.im * odd_re;
+	}
+	return this->spectrum;
 }
 
 FFT::~FFT()
 {
-	gpu_fft_release(this->fft);
+	delete this->backend;
+	delete this->transferFunction;
+	delete[] this->realTwiddles;
+	delete[] this->spectrum;
+	delete[] this->window;
 	this->DeleteBins();
 	return;
 }
\ No newline at end of file
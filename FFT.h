@@ -3,26 +3,19 @@
 #include <cmath>
 #include <math.h>
 #include <stdexcept>
+#include <vector>
 
-#include "gpu_fft.h"
-#include "mailbox.h"
+#include "BinHistory.h"
+#include "FFTBackend.h"
+#include "TransferFunction.h"
+#include "WindowedMax.h"
 
-// number of fft jobs (always 1?)
-#define FFT_JOBS 1
-#define FULL_SCALE 100.0
-// sigmoid numerator value
-// with logarithmic also enabled, decreasing this value allows you to stretch the sigmoid shape along the x-axis
-#define SIGMOID_NUMERATOR 10.0
-// sigmoid X offset (higher = more low frequency attenuation, more amplitude required to hit gain threshold)
-// with logarithmic also enabled, increasing this number will exponentially increase the amount of amplitude required to hit full scale db
-#define SIGMOID_OFFSET 25.0
-// sigmoid sloep (higher = slopes slower, less effect of attenuation/gain)
-// with logarithmic also enabled, increasing this number will result in a sharper corner and a closer resemblance to the 20log10 function
-// *** this parameter is of great interest
-#define SIGMOID_SLOPE 12.0
+// lowest band edge used when generating default bands (hz)
+#define MIN_BAND_FREQUENCY 20.0
 
 enum FFTEvents { NoneFFTEvent = 0, DecreasedAmplitudeFFTEvent = 1, IncreasedAmplitudeFFTEvent = 2, ReturnToLevelFFTEvent = 3 };
 enum FFTEventStates { StandardFFTEventState = 0, QuietFFTEventState = 1, LoudFFTEventState = 2};
+enum FFTWindowTypes { RectangularFFTWindowType = 0, HannFFTWindowType = 1, BlackmanHarrisFFTWindowType = 2 };
 enum FFTOptions { None = 0, Logarithmic = 1, Sigmoid = 2, Autoscale = 4 };
 
 inline FFTOptions operator|(FFTOptions a, FFTOptions b) { return static_cast<FFTOptions>(static_cast<int>(a) | static_cast<int>(b)); }
@@ -32,28 +25,43 @@ class FFT
 {
 
 public:
-	FFT(int log, int sample_rate);
+	FFT(int log, int sample_rate, FFTBackendTypes backend = AutoFFTBackendType, bool real_input = true);
 	~FFT();
 
 	void Analyze(int* bins, int count, int& min, int& max, int& avg);
-	void Archive(int** bins, int count, int depth);
 	void Create(int count, int depth);
-	int** Cycle(short* buffer, int display_depth, float seconds);
-	void Get(short* buffer, int* bins, int bin_count, int sample_rate);
+	BinHistory* Cycle(short* buffer, int display_depth, float seconds);
+	void Get(short* buffer, int* bins, int bin_count);
 	void GetColorGains(float& red_gain, float& green_gain, float& blue_gain);
 	FFTEvents GetEvents();
-	void Normalize(int** bins, int** normalized_bins, int count, int depth, int total_depth, FFTOptions options);
+	void SetBandEdges(const std::vector<float>& edges);
+	void SetSigmoid(double numerator, double offset, double slope);
+	void SetWindow(FFTWindowTypes type);
+	GPU_FFT_COMPLEX* Transform(short* buffer);
 
 private:
 	int fftLog;
 	int sampleRate;
-	int mailbox;
-	struct GPU_FFT *fft;
+	FFTBackend* backend;
+	// real input mode: N real samples packed into an N/2 point complex transform
+	bool realInput;
+	GPU_FFT_COMPLEX* realTwiddles;
+	GPU_FFT_COMPLEX* spectrum;
+	// analysis window applied while loading samples (normalized to unity mean)
+	float* window;
 
 	int binCount;
 	int binDepth;
-	int** bins;
-	int** normalizedBins;
+	BinHistory* bins;
+	BinHistory* normalizedBins;
+	// db converted history (each row converted once) and per-band running max over the whole history
+	BinHistory* decibelBins;
+	std::vector<WindowedMax*> binMaxs;
+	TransferFunction* transferFunction;
+	// band edges (hz, count + 1) and the [start, end) run of fft bins falling within each band
+	float* bandEdges;
+	int* bandStarts;
+	int* bandEnds;
 	float redGain = 1.0, greenGain = 1.0, blueGain = 1.0;
 
 	float eventInvalidated = 0.0;
@@ -63,9 +71,11 @@ private:
 	FFTEventStates fftEventState;
 	FFTEventStates fftEventStatePending;
 
+	void CreateBandTable();
 	void DeleteBins();
 	FFTEventStates DetectEventState(int min, int max, int avg, float seconds);
 	FFTEvents DetectEventTransition(FFTEventStates old_state, FFTEventStates new_state);
-	double SigmoidFunction(double value);
+	// normalize the newest depth rows of the db history into normalized_bins (db conversion happens in Cycle)
+	void Normalize(BinHistory* normalized_bins, int depth, FFTOptions options);
 
 };
\ No newline at end of file
@@ -0,0 +1,34 @@
+#include "FFTBackend.h"
+#include "CPUFFTBackend.h"
+#include "GPUFFTBackend.h"
+
+using namespace std;
+
+FFTBackend* FFTBackend::Create(FFTBackendTypes type, int log, int direction)
+{
+	FFTBackend* backend = NULL;
+	switch (type)
+	{
+		case GPUFFTBackendType:
+			backend = new GPUFFTBackend(log, direction);
+			break;
+		case CPUFFTBackendType:
+			backend = new CPUFFTBackend(log, direction);
+			break;
+		default:
+		case AutoFFTBackendType:
+			// prefer the V3D block, fall back to the cpu when it is unavailable
+			try
+			{
+				backend = new GPUFFTBackend(log, direction);
+			}
+			catch (const runtime_error& ex)
+			{
+				fprintf(stderr, "GPU FFT unavailable, falling back to CPU FFT: %s", ex.what());
+				backend = new CPUFFTBackend(log, direction);
+			}
+			break;
+	}
+	fprintf(stderr, "Using %s FFT backend\n", backend->GetName());
+	return backend;
+}
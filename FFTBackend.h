@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stdexcept>
+#include <stdio.h>
+
+#include "gpu_fft.h"
+
+enum FFTBackendTypes { AutoFFTBackendType = 0, GPUFFTBackendType = 1, CPUFFTBackendType = 2 };
+
+class FFTBackend
+{
+
+public:
+	virtual ~FFTBackend() {}
+
+	// create a backend of the given type (auto = gpu if available, otherwise cpu)
+	static FFTBackend* Create(FFTBackendTypes type, int log, int direction);
+
+	// input/output buffers of 2^log complex values (same layout as GPU_FFT)
+	virtual GPU_FFT_COMPLEX* GetInput() = 0;
+	virtual GPU_FFT_COMPLEX* GetOutput() = 0;
+	virtual const char* GetName() = 0;
+	virtual void Execute() = 0;
+
+};
@@ -0,0 +1,56 @@
+#include "FileAudioSource.h"
+
+using namespace std;
+
+FileAudioSource::FileAudioSource(const string& filename, bool real_time) : AudioSource(real_time)
+{
+	fprintf(stderr, "Opening audio file %s\n", filename.c_str());
+	SF_INFO info;
+	info.format = 0;
+	this->file = sf_open(filename.c_str(), SFM_READ, &info);
+	if (this->file == NULL)
+		throw runtime_error(string("Failed to open audio file: ") + sf_strerror(NULL));
+	if (info.samplerate != SAMP_RATE)
+	{
+		sf_close(this->file);
+		throw invalid_argument("Audio file sample rate must be " + to_string(SAMP_RATE) + " hz!");
+	}
+	this->channels = info.channels;
+	return;
+}
+
+void FileAudioSource::Capture()
+{
+	short frames[CAPTURE_CHUNK_SIZE * this->channels];
+	short samples[CAPTURE_CHUNK_SIZE];
+	struct timespec deadline;
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+	while (this->capturing.load(memory_order_relaxed))
+	{
+		sf_count_t count = sf_readf_short(this->file, frames, CAPTURE_CHUNK_SIZE);
+		if (count <= 0)
+			break;
+		// mix down to mono
+		for (int i = 0; i < count; i++)
+		{
+			int sum = 0;
+			for (int channel = 0; channel < this->channels; channel++)
+			{
+				sum += frames[i * this->channels + channel];
+			}
+			samples[i] = (short)(sum / this->channels);
+		}
+		this->Write(samples, count);
+		this->Pace(deadline, count);
+	}
+	// end of file
+	this->capturing = false;
+	return;
+}
+
+FileAudioSource::~FileAudioSource()
+{
+	this->Stop();
+	sf_close(this->file);
+	return;
+}
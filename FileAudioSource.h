@@ -0,0 +1,22 @@
+#pragma once
+
+#include <sndfile.h>
+#include <stdexcept>
+#include <string>
+
+#include "AudioSource.h"
+
+// wav/flac/etc. replay through libsndfile (mixed down to mono)
+class FileAudioSource : public AudioSource
+{
+public:
+	FileAudioSource(const std::string& filename, bool real_time = true);
+	~FileAudioSource();
+
+protected:
+	void Capture();
+
+private:
+	SNDFILE* file;
+	int channels;
+};
@@ -0,0 +1,81 @@
+#include "FrameScheduler.h"
+
+using namespace std;
+
+FrameScheduler::FrameScheduler(float fps, int max_late_frames)
+{
+	if (fps < 0.0 || max_late_frames < 0)
+		throw invalid_argument("Invalid frame scheduler parameters");
+	this->period = fps > 0.0 ? (long long)(NANOSECONDS_PER_SECOND / fps) : 0;
+	this->maxLateFrames = max_late_frames;
+	this->Start();
+	return;
+}
+
+float FrameScheduler::GetSeconds() const
+{
+	return (float)(FrameScheduler::Now() - this->startTime) / (float)NANOSECONDS_PER_SECOND;
+}
+
+long long FrameScheduler::Now()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (long long)now.tv_sec * NANOSECONDS_PER_SECOND + now.tv_nsec;
+}
+
+void FrameScheduler::PrintStats() const
+{
+	fprintf(stderr, "Rendered %lu frames in %.1f s (%lu skipped), frame time %.2f ms average, %.2f ms max\n", this->frameCount, this->GetSeconds(),
+		this->skippedFrames, this->GetAverageFrameTime() * 1000.0, this->GetMaxFrameTime() * 1000.0);
+	return;
+}
+
+void FrameScheduler::Start()
+{
+	// restart the clock and the stats
+	this->startTime = FrameScheduler::Now();
+	this->deadline = this->startTime + this->period;
+	this->frameStart = this->startTime;
+	this->frameCount = 0;
+	this->skippedFrames = 0;
+	this->busyTotal = 0;
+	this->busyMax = 0;
+	return;
+}
+
+void FrameScheduler::Wait()
+{
+	// end of a frame's work
+	long long now = FrameScheduler::Now();
+	long long busy = now - this->frameStart;
+	this->busyTotal += busy;
+	this->busyMax = busy > this->busyMax ? busy : this->busyMax;
+	this->frameCount++;
+	if (this->period > 0)
+	{
+		// too far behind, give up on the missed deadlines instead of rendering a burst of frames to catch up
+		long long late = (now - this->deadline) / this->period;
+		if (late > this->maxLateFrames)
+		{
+			this->deadline += late * this->period;
+			this->skippedFrames += late;
+		}
+		// sleep until the absolute deadline (no drift from the time spent working)
+		if (now < this->deadline)
+		{
+			struct timespec deadline;
+			deadline.tv_sec = this->deadline / NANOSECONDS_PER_SECOND;
+			deadline.tv_nsec = this->deadline % NANOSECONDS_PER_SECOND;
+			while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR);
+		}
+		this->deadline += this->period;
+	}
+	this->frameStart = FrameScheduler::Now();
+	return;
+}
+
+FrameScheduler::~FrameScheduler()
+{
+	return;
+}
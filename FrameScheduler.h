@@ -0,0 +1,53 @@
+#pragma once
+
+#include <errno.h>
+#include <stdexcept>
+#include <stdio.h>
+#include <time.h>
+
+#define NANOSECONDS_PER_SECOND 1000000000LL
+
+// paces the display loop on CLOCK_MONOTONIC (wall time, unaffected by cpu load)
+class FrameScheduler
+{
+public:
+	FrameScheduler(float fps = 0.0, int max_late_frames = 2);
+	~FrameScheduler();
+
+	// average and longest time spent working on a frame (seconds)
+	double GetAverageFrameTime() const
+	{
+		return this->frameCount > 0 ? (double)this->busyTotal / this->frameCount / NANOSECONDS_PER_SECOND : 0.0;
+	}
+	unsigned long GetFrameCount() const
+	{
+		return this->frameCount;
+	}
+	double GetMaxFrameTime() const
+	{
+		return (double)this->busyMax / NANOSECONDS_PER_SECOND;
+	}
+	float GetSeconds() const;
+	unsigned long GetSkippedFrames() const
+	{
+		return this->skippedFrames;
+	}
+	void PrintStats() const;
+	void Start();
+	void Wait();
+
+private:
+	// frame period (ns, 0 = unpaced)
+	long long period;
+	// deadlines this far behind are dropped instead of caught up on
+	int maxLateFrames;
+	long long startTime;
+	long long deadline;
+	long long frameStart;
+	unsigned long frameCount;
+	unsigned long skippedFrames;
+	long long busyTotal;
+	long long busyMax;
+
+	static long long Now();
+};
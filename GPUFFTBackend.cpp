@@ -0,0 +1,53 @@
+#include "GPUFFTBackend.h"
+
+using namespace std;
+
+GPUFFTBackend::GPUFFTBackend(int log, int direction)
+{
+	this->fft = NULL;
+	// mbox_open() exits the process on failure, so check for the device first
+	if (access(DEVICE_FILE_NAME, F_OK) != 0)
+		throw runtime_error("Can't open VideoCore mailbox device.\n");
+	this->mailbox = mbox_open();
+	int ret = gpu_fft_prepare(this->mailbox, log, direction, FFT_JOBS, &(this->fft));
+	if (ret != 0)
+		mbox_close(this->mailbox);
+
+	switch (ret)
+	{
+		case -1: throw runtime_error("Unable to enable V3D. Please check your firmware is up to date.\n");
+		case -2: throw runtime_error("log2_N=%d not supported.  Try between 8 and 22.\n");
+		case -3: throw runtime_error("Out of memory.  Try a smaller batch or increase GPU memory.\n");
+		case -4: throw runtime_error("Unable to map Videocore peripherals into ARM memory space.\n");
+		case -5: throw runtime_error("Can't open libbcm_host.\n");
+	}
+	return;
+}
+
+GPU_FFT_COMPLEX* GPUFFTBackend::GetInput()
+{
+	return this->fft->in;
+}
+
+GPU_FFT_COMPLEX* GPUFFTBackend::GetOutput()
+{
+	return this->fft->out;
+}
+
+const char* GPUFFTBackend::GetName()
+{
+	return "GPU";
+}
+
+void GPUFFTBackend::Execute()
+{
+	gpu_fft_execute(this->fft);
+	return;
+}
+
+GPUFFTBackend::~GPUFFTBackend()
+{
+	gpu_fft_release(this->fft);
+	mbox_close(this->mailbox);
+	return;
+}
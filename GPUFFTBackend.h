@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdexcept>
+#include <unistd.h>
+
+#include "FFTBackend.h"
+#include "gpu_fft.h"
+#include "mailbox.h"
+
+// number of fft jobs (always 1?)
+#define FFT_JOBS 1
+
+class GPUFFTBackend : public FFTBackend
+{
+
+public:
+	GPUFFTBackend(int log, int direction);
+	~GPUFFTBackend();
+
+	GPU_FFT_COMPLEX* GetInput();
+	GPU_FFT_COMPLEX* GetOutput();
+	const char* GetName();
+	void Execute();
+
+private:
+	int mailbox;
+	struct GPU_FFT *fft;
+
+};
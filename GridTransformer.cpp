@@ -23,19 +23,110 @@ GridTransformer::GridTransformer(int width, int height, int panel_width, int pan
   // Check panel definition list has exactly the expected number of panels.
   assert((_rows * _cols) == (int)_panels.size());
 
-  this->pixelStates = new bool*[width];
-  for (int x = 0; x < width; x++)
-  {
-	  this->pixelStates[x] = new bool[height];
-  }
+  this->writtenWords = (width + DIRTY_WORD_BITS - 1) / DIRTY_WORD_BITS;
+  this->writtenStates = new uint64_t[this->writtenWords * height];
+  memset(this->writtenStates, 0, sizeof(uint64_t) * this->writtenWords * height);
+  this->writtenTop = height;
+  this->writtenBottom = 0;
+  this->emittedPixels = 0;
+  this->_tracker = NULL;
+  this->SelectTracker();
+  this->CreatePixelMap();
+  this->runBuffer = new uint8_t[3 * _width];
+  this->blackBuffer = new uint8_t[3 * _width];
+  memset(this->blackBuffer, 0, 3 * _width);
 
   this->cutoff = 0;
   this->enableCutoff = true;
   this->enablePixelOverwrite = false;
-  this->maxBrightness = 255;
   return;
 }
 
+void GridTransformer::Blit(int x, int y, int width, int height, const uint8_t* rgb, int stride)
+{
+	for (int row = 0; row < height; row++)
+	{
+		this->SetRow(y + row, x, rgb + row * stride, width);
+	}
+	return;
+}
+
+void GridTransformer::CreatePixelMap()
+{
+  // Resolve every logical pixel to its physical location once, so SetPixel
+  // is a single table load instead of per-pixel panel arithmetic.
+  this->pixelMap = new uint32_t[_width * _height];
+  for (int logical_y = 0; logical_y < _height; logical_y++) {
+    for (int logical_x = 0; logical_x < _width; logical_x++) {
+      // Figure out what row and column panel this pixel is within.
+      int row = logical_y / _panel_height;
+      int col = logical_x / _panel_width;
+
+      // Get the panel information for this pixel.
+      const Panel& panel = _panels[_cols*row + col];
+
+      // Compute location of the pixel within the panel.
+      int x = logical_x % _panel_width;
+      int y = logical_y % _panel_height;
+
+      // Perform any panel rotation to the pixel.
+      // NOTE: 90 and 270 degree rotation only possible on 32 row (square) panels.
+      if (panel.rotate == 90) {
+        assert(_panel_height == _panel_width);
+        int old_x = x;
+        x = (_panel_height-1)-y;
+        y = old_x;
+      }
+      else if (panel.rotate == 180) {
+        x = (_panel_width-1)-x;
+        y = (_panel_height-1)-y;
+      }
+      else if (panel.rotate == 270) {
+        assert(_panel_height == _panel_width);
+        int old_y = y;
+        y = (_panel_width-1)-x;
+        x = old_y;
+      }
+
+      // Determine x offset into the source panel based on its order along the chain.
+      // The order needs to be inverted because the matrix library starts with the
+      // origin of an image at the end of the chain and not at the start (where
+      // ordering begins for this transformer).
+      int x_offset = ((_chain_length-1)-panel.order)*_panel_width;
+
+      // Determine y offset into the source panel based on its parrallel chain value.
+      int y_offset = panel.parallel*_panel_height;
+
+      this->pixelMap[logical_y * _width + logical_x] = ((uint32_t)(x_offset + x) << 16) | (uint32_t)(y_offset + y);
+    }
+  }
+  return;
+}
+
+void GridTransformer::EmitSpan(int y, int x0, const uint8_t* rgb, int n)
+{
+	// split a logical span into physically contiguous runs
+	const uint32_t* map = this->pixelMap + y * this->_width + x0;
+	int run_start = 0, run_step = 0;
+	for (int i = 1; i < n; i++)
+	{
+		// extend the current run while the physical column keeps moving by one in the same direction
+		int step = (int)(map[i] - map[i - 1]);
+		if ((i - run_start == 1 && (step == (1 << 16) || step == -(1 << 16))) || (i - run_start > 1 && step == run_step))
+		{
+			run_step = step;
+			continue;
+		}
+		this->WriteRun(map[run_start], run_step, rgb + 3 * run_start, i - run_start);
+		run_start = i;
+		run_step = 0;
+	}
+	if (n > 0)
+		this->WriteRun(map[run_start], run_step, rgb + 3 * run_start, n - run_start);
+	this->emittedPixels += n;
+	return;
+}
+
 void GridTransformer::EnableCutoff(bool value)
 {
 	this->enableCutoff = value;
@@ -49,19 +140,82 @@ void GridTransformer::EnablePixelOverwrite(bool value)
   return;
 }
 
+void GridTransformer::FinishFrame()
+{
+	// erase pixels lit on this canvas before but not drawn this frame (a word of pixels at a time)
+	int lit_top = this->_height, lit_bottom = 0;
+	for (int y = this->_tracker->GetLitTop(); y < this->_tracker->GetLitBottom(); y++)
+	{
+		uint64_t* lit = this->_tracker->GetLitRow(y);
+		const uint64_t* written = this->writtenStates + y * this->writtenWords;
+		bool row_lit = false;
+		for (int word = 0; word < this->writtenWords; word++)
+		{
+			uint64_t stale = lit[word] & ~written[word];
+			while (stale)
+			{
+				int start = __builtin_ctzll(stale);
+				uint64_t remaining = ~(stale >> start);
+				int count = remaining ? __builtin_ctzll(remaining) : DIRTY_WORD_BITS - start;
+				int x = word * DIRTY_WORD_BITS + start;
+				this->EmitSpan(y, x, this->blackBuffer, count);
+				this->_tracker->Erase(x, y, count);
+				stale = lit[word] & ~written[word];
+			}
+			row_lit |= lit[word] != 0;
+		}
+		if (row_lit)
+		{
+			lit_top = y < lit_top ? y : lit_top;
+			lit_bottom = y + 1;
+		}
+	}
+	this->_tracker->SetLitRows(lit_top, lit_bottom);
+	return;
+}
+
+void GridTransformer::Repaint()
+{
+	// black stays black at any brightness, only lit rows need writing
+	for (int y = this->_tracker->GetLitTop(); y < this->_tracker->GetLitBottom(); y++)
+	{
+		this->EmitSpan(y, 0, this->_tracker->GetRow(y), this->_width);
+	}
+	return;
+}
+
+void GridTransformer::ResetPixelStates()
+{
+	// only rows drawn into since the last reset can hold set bits
+	if (this->writtenBottom > this->writtenTop)
+		memset(this->writtenStates + this->writtenTop * this->writtenWords, 0, sizeof(uint64_t) * this->writtenWords * (this->writtenBottom - this->writtenTop));
+	this->writtenTop = this->_height;
+	this->writtenBottom = 0;
+	return;
+}
+
 void GridTransformer::ResetScreen()
 {
-	this->EnableCutoff(false);
-	for (int x = 0; x < this->_width; x++)
+	// start a new frame on the (offscreen) source canvas, its previous contents stay until FinishFrame
+	this->ResetPixelStates();
+	this->emittedPixels = 0;
+	return;
+}
+
+void GridTransformer::SelectTracker()
+{
+	for (size_t i = 0; i < this->_trackers.size(); i++)
 	{
-		for (int y = 0; y < this->_height; y++)
+		if (this->_trackers[i]->GetCanvas() == this->_source)
 		{
-			if (!this->pixelStates[x][y])
-				this->SetPixel(x, y, 0, 0, 0);
-			this->pixelStates[x][y] = false;
+			this->_tracker = this->_trackers[i];
+			return;
 		}
 	}
-	this->EnableCutoff(true);
+	// first time drawing into this canvas, start from a known (black) state
+	this->_source->Clear();
+	this->_tracker = new DirtyTracker(this->_source, this->_width, this->_height);
+	this->_trackers.push_back(this->_tracker);
 	return;
 }
 
@@ -75,51 +229,65 @@ void GridTransformer::SetPixel(int x, int y, uint8_t red, uint8_t green, uint8_t
 		return;
 
 	// check if pixel already written to
-	if (this->pixelStates[x][y] && !this->enablePixelOverwrite)
+	uint64_t* written = this->writtenStates + y * this->writtenWords + x / DIRTY_WORD_BITS;
+	uint64_t bit = 1ULL << (x % DIRTY_WORD_BITS);
+	if ((*written & bit) && !this->enablePixelOverwrite)
 		return;
-	this->pixelStates[x][y] = true;
-
-	// Figure out what row and column panel this pixel is within.
-	int row = y / this->_panel_height;
-	int col = x / this->_panel_width;
-
-  // Get the panel information for this pixel.
-  Panel panel = _panels[_cols*row + col];
-
-  // Compute location of the pixel within the panel.
-  x = x % _panel_width;
-  y = y % _panel_height;
-
-  // Perform any panel rotation to the pixel.
-  // NOTE: 90 and 270 degree rotation only possible on 32 row (square) panels.
-  if (panel.rotate == 90) {
-    assert(_panel_height == _panel_width);
-    int old_x = x;
-    x = (_panel_height-1)-y;
-    y = old_x;
-  }
-  else if (panel.rotate == 180) {
-    x = (_panel_width-1)-x;
-    y = (_panel_height-1)-y;
-  }
-  else if (panel.rotate == 270) {
-    assert(_panel_height == _panel_width);
-    int old_y = y;
-    y = (_panel_width-1)-x;
-    x = old_y;
-  }
+	*written |= bit;
+	this->writtenTop = y < this->writtenTop ? y : this->writtenTop;
+	this->writtenBottom = y >= this->writtenBottom ? y + 1 : this->writtenBottom;
 
-  // Determine x offset into the source panel based on its order along the chain.
-  // The order needs to be inverted because the matrix library starts with the
-  // origin of an image at the end of the chain and not at the start (where
-  // ordering begins for this transformer).
-  int x_offset = ((_chain_length-1)-panel.order)*_panel_width;
+	// check if the canvas already shows this color
+	const uint8_t rgb[3] = { red, green, blue };
+	if (!this->_tracker->Update(x, y, rgb))
+		return;
+	this->emittedPixels++;
 
-  // Determine y offset into the source panel based on its parrallel chain value.
-  int y_offset = panel.parallel*_panel_height;
+	// Look up the physical location (packed x << 16 | y).
+	uint32_t physical = this->pixelMap[y * this->_width + x];
+	this->_source->SetPixel(physical >> 16, physical & 0xFFFF, red, green, blue);
+	return;
+}
 
-  this->_source->SetPixel(x_offset + x, y_offset + y, red, green, blue);
-  return;
+void GridTransformer::SetRow(int y, int x0, const uint8_t* rgb, int n)
+{
+	// check span boundaries
+	assert(y >= 0 && y < this->_height && x0 >= 0 && x0 + n <= this->_width);
+	if (n <= 0)
+		return;
+	this->writtenTop = y < this->writtenTop ? y : this->writtenTop;
+	this->writtenBottom = y >= this->writtenBottom ? y + 1 : this->writtenBottom;
+
+	uint64_t* written = this->writtenStates + y * this->writtenWords;
+	int span_start = 0, span_count = 0;
+	for (int i = 0; i < n; i++)
+	{
+		int x = x0 + i;
+		const uint8_t* pixel = rgb + 3 * i;
+		uint64_t* word = written + x / DIRTY_WORD_BITS;
+		uint64_t bit = 1ULL << (x % DIRTY_WORD_BITS);
+		// same per pixel rules as SetPixel (cutoff, first write wins), unchanged pixels are not re-emitted
+		bool skip = (pixel[0] < this->cutoff && pixel[1] < this->cutoff && pixel[2] < this->cutoff && this->enableCutoff)
+			|| ((*word & bit) && !this->enablePixelOverwrite);
+		if (!skip)
+		{
+			*word |= bit;
+			skip = !this->_tracker->Update(x, y, pixel);
+		}
+		if (skip)
+		{
+			if (span_count > 0)
+				this->EmitSpan(y, x0 + span_start, rgb + 3 * span_start, span_count);
+			span_count = 0;
+			continue;
+		}
+		if (span_count == 0)
+			span_start = i;
+		span_count++;
+	}
+	if (span_count > 0)
+		this->EmitSpan(y, x0 + span_start, rgb + 3 * span_start, span_count);
+	return;
 }
 
 void GridTransformer::SetCutoff(int value)
@@ -128,9 +296,30 @@ void GridTransformer::SetCutoff(int value)
 	return;
 }
 
-void GridTransformer::SetMaxBrightness(int value)
+void GridTransformer::SetSource(Canvas* source)
 {
-	this->maxBrightness = value;
+	// retarget drawing (e.g. to the next offscreen frame canvas)
+	assert(source != NULL);
+	this->_source = source;
+	this->SelectTracker();
+	return;
+}
+
+void GridTransformer::WriteRun(uint32_t physical, int step, const uint8_t* rgb, int count)
+{
+	int x = physical >> 16;
+	int y = physical & 0xFFFF;
+	if (step >= 0)
+	{
+		this->_source->SetPixels(x, y, count, rgb);
+		return;
+	}
+	// physical x runs backwards (180 degree panel), write it left to right
+	for (int i = 0; i < count; i++)
+	{
+		memcpy(this->runBuffer + 3 * i, rgb + 3 * (count - 1 - i), 3);
+	}
+	this->_source->SetPixels(x - (count - 1), y, count, this->runBuffer);
 	return;
 }
 
@@ -141,15 +330,19 @@ Canvas* GridTransformer::Transform(Canvas* source)
   int sheight = source->height();
   assert((_width * _height) == (swidth * sheight));
   _source = source;
+  SelectTracker();
   return this;
 }
 
 GridTransformer::~GridTransformer()
 {
-	for (int x = 0; x < this->_width; x++)
+	for (size_t i = 0; i < this->_trackers.size(); i++)
 	{
-		delete this->pixelStates[x];
+		delete this->_trackers[i];
 	}
-	delete this->pixelStates;
+	delete[] this->writtenStates;
+	delete[] this->pixelMap;
+	delete[] this->runBuffer;
+	delete[] this->blackBuffer;
 	return;
 }
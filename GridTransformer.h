@@ -5,10 +5,13 @@
 #define GRIDTRANSFORMER_H
 
 #include <cassert>
+#include <string.h>
 #include <vector>
 
 #include "led-matrix.h"
 
+#include "DirtyTracker.h"
+
 
 class GridTransformer: public rgb_matrix::Canvas, public rgb_matrix::CanvasTransformer
 {
@@ -34,14 +37,24 @@ class GridTransformer: public rgb_matrix::Canvas, public rgb_matrix::CanvasTrans
   virtual void Clear() {
     assert(_source != NULL);
     _source->Clear();
+    _tracker->Clear();
   }
     
   
   virtual void Fill(uint8_t red, uint8_t green, uint8_t blue) {
     assert(_source != NULL);
     _source->Fill(red, green, blue);
+    _tracker->Fill(red, green, blue);
   }
   virtual void SetPixel(int x, int y, uint8_t red, uint8_t green, uint8_t blue);
+  virtual void SetPixels(int x, int y, int count, const uint8_t* rgb) {
+    SetRow(y, x, rgb, count);
+  }
+
+  // Bulk drawing (packed 24bpp rgb): panel mapping is resolved per span and
+  // each physically contiguous run is written with one call to the source.
+  void Blit(int x, int y, int width, int height, const uint8_t* rgb, int stride);
+  void SetRow(int y, int x0, const uint8_t* rgb, int n);
 
   // Transformer interface implementation:
   virtual rgb_matrix::Canvas* Transform(rgb_matrix::Canvas* source);
@@ -56,8 +69,22 @@ class GridTransformer: public rgb_matrix::Canvas, public rgb_matrix::CanvasTrans
   void EnableCutoff(bool value);
   void EnablePixelOverwrite(bool value);
   void SetCutoff(int value);
-  void SetMaxBrightness(int value);
+  void SetSource(rgb_matrix::Canvas* source);
+  // Frame boundaries: ResetScreen starts a frame on the current source,
+  // FinishFrame blacks out whatever was lit last time but not drawn since.
+  void FinishFrame();
   void ResetScreen();
+  // Pixels actually sent to the source canvas since the last ResetScreen.
+  int GetEmittedPixels() const {
+    return emittedPixels;
+  }
+  // Histogram of the channel values the current source shows.
+  const uint32_t* GetLevels() const {
+    return _tracker->GetLevels();
+  }
+  // Write everything the current source shows again (after its brightness
+  // changed, which only applies to newly set pixels).
+  void Repaint();
 
 private:
   int _width,
@@ -67,13 +94,33 @@ private:
       _chain_length,
       _rows,
       _cols;
-  int cutoff,
-	  maxBrightness;
+  int cutoff;
   rgb_matrix::Canvas* _source;
-  bool ** pixelStates;
+  // contents of each canvas drawn through (frame canvases alternate)
+  std::vector<DirtyTracker*> _trackers;
+  DirtyTracker* _tracker;
+  // pixels drawn this frame, one bit each, rows [writtenTop, writtenBottom) dirty
+  uint64_t* writtenStates;
+  int writtenWords,
+      writtenTop,
+      writtenBottom,
+      emittedPixels;
+  // physical location of each logical pixel (x << 16 | y, row major)
+  uint32_t* pixelMap;
+  // reversed copy of runs landing on 180 degree rotated panels
+  uint8_t* runBuffer;
+  // all black row for erasing stale runs
+  uint8_t* blackBuffer;
   bool enablePixelOverwrite;
   bool enableCutoff;
   std::vector<Panel> _panels;
+
+  void CreatePixelMap();
+  void EmitSpan(int y, int x0, const uint8_t* rgb, int n);
+  // Forget which pixels were drawn this frame.
+  void ResetPixelStates();
+  void SelectTracker();
+  void WriteRun(uint32_t physical, int step, const uint8_t* rgb, int count);
 };
 
 #endif
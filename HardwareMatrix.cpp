@@ -0,0 +1,67 @@
+#include "HardwareMatrix.h"
+
+using namespace rgb_matrix;
+using namespace std;
+
+HardwareMatrix::HardwareMatrix(int rows, int chain_length, int parallel_count, int pwm_bits, int pwm_dither_bits, int swap_queue_depth)
+{
+	this->matrix = new RGBMatrix(rows, chain_length, parallel_count);
+	// color depth shown per refresh, and the bits below it spread over successive refreshes (applies to canvases created from here on)
+	if (!this->matrix->SetPWMBits(pwm_bits) || !this->matrix->SetPWMDitherBits(pwm_dither_bits))
+	{
+		delete this->matrix;
+		throw invalid_argument("Invalid pwm bits!");
+	}
+	this->matrix->Fill(0, 0, 0);
+	// frames that may wait for the refresh thread (deeper queues let the renderer run ahead)
+	if (!this->matrix->SetSwapQueueDepth(swap_queue_depth))
+	{
+		delete this->matrix;
+		throw invalid_argument("Invalid swap queue depth!");
+	}
+	// draw offscreen, present on vsync
+	this->offscreen = this->matrix->CreateFrameCanvas();
+	return;
+}
+
+void HardwareMatrix::Clear()
+{
+	this->matrix->Clear();
+	return;
+}
+
+Canvas* HardwareMatrix::GetOffscreen()
+{
+	return this->offscreen;
+}
+
+bool HardwareMatrix::SetBrightness(int percent)
+{
+	if (this->offscreen->brightness() == percent)
+		return false;
+	this->offscreen->SetBrightness(percent);
+	return true;
+}
+
+Canvas* HardwareMatrix::Swap(int vsync_fraction)
+{
+	this->offscreen = this->matrix->SwapOnVSync(this->offscreen, vsync_fraction);
+	return this->offscreen;
+}
+
+Canvas* HardwareMatrix::TrySwap(int vsync_fraction)
+{
+	// the refresh thread keeps showing what it has, draw the next frame over this one instead
+	FrameCanvas* next = this->matrix->TrySwap(this->offscreen, vsync_fraction);
+	if (next == NULL)
+		return NULL;
+	this->offscreen = next;
+	return this->offscreen;
+}
+
+HardwareMatrix::~HardwareMatrix()
+{
+	// frame canvases are owned by the matrix
+	delete this->matrix;
+	return;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <led-matrix.h>
+
+#include "MatrixBackend.h"
+
+// panels driven over gpio by the rpi-rgb-led-matrix refresh thread
+class HardwareMatrix : public MatrixBackend
+{
+
+public:
+	HardwareMatrix(int rows, int chain_length, int parallel_count, int pwm_bits = 11, int pwm_dither_bits = 0, int swap_queue_depth = 1);
+	~HardwareMatrix();
+
+	void Clear();
+	const char* GetName()
+	{
+		return "hardware";
+	}
+	rgb_matrix::Canvas* GetOffscreen();
+	bool SetBrightness(int percent);
+	rgb_matrix::Canvas* Swap(int vsync_fraction);
+	rgb_matrix::Canvas* TrySwap(int vsync_fraction);
+
+private:
+	rgb_matrix::RGBMatrix* matrix;
+	// frame being drawn while the other one is scanned out
+	rgb_matrix::FrameCanvas* offscreen;
+};
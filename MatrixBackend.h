@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdexcept>
+#include <stdio.h>
+
+#include "canvas.h"
+
+enum MatrixBackendTypes { HardwareMatrixBackendType = 0, VirtualMatrixBackendType = 1 };
+
+// destination of finished frames (panel chain on the gpio pins, or memory)
+class MatrixBackend
+{
+
+public:
+	virtual ~MatrixBackend() {}
+
+	// blank what is currently shown
+	virtual void Clear() = 0;
+	virtual const char* GetName() = 0;
+	// panel brightness of the offscreen frame in percent (applies to pixels set from now on), false if unchanged
+	virtual bool SetBrightness(int percent) = 0;
+	// canvas the next frame is drawn into (physical panel layout)
+	virtual rgb_matrix::Canvas* GetOffscreen() = 0;
+	// show the offscreen frame (after every nth refresh) and return the canvas for the frame after it
+	virtual rgb_matrix::Canvas* Swap(int vsync_fraction) = 0;
+	// like Swap without waiting, returns NULL (and keeps the offscreen frame) when it can't be queued yet
+	virtual rgb_matrix::Canvas* TrySwap(int vsync_fraction) = 0;
+
+};
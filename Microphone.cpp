@@ -2,9 +2,10 @@
 
 using namespace std;
 
-Microphone::Microphone(std::string device)
+Microphone::Microphone(std::string device, CaptureAccessTypes access, int period_size, int buffer_size)
 {
 	fprintf(stderr, "Initializing Audio Device\n");
+	this->access = access;
 	const char * device_str = (const char *)device.c_str();
 	int err;
 	/* Open the PCM device in playback mode */
@@ -29,7 +30,8 @@ Microphone::Microphone(std::string device)
 			snd_strerror(err));
 	}
 	/* Set parameters */
-	if ((err = snd_pcm_hw_params_set_access(pcm_handle, params, SND_PCM_ACCESS_RW_INTERLEAVED)) < 0)
+	snd_pcm_access_t access_type = access == MMapCaptureAccessType ? SND_PCM_ACCESS_MMAP_INTERLEAVED : SND_PCM_ACCESS_RW_INTERLEAVED;
+	if ((err = snd_pcm_hw_params_set_access(pcm_handle, params, access_type)) < 0)
 	{
 		fprintf(stderr, "cannot set access type (%s)\n", snd_strerror(err));
 		exit(1);
@@ -51,6 +53,19 @@ Microphone::Microphone(std::string device)
 		fprintf(stderr, "cannot set sample rate (%s)\n", snd_strerror(err));
 		exit(1);
 	}
+	// period/buffer sizes (optional, device defaults otherwise)
+	snd_pcm_uframes_t frames = period_size;
+	if (period_size > 0 && (err = snd_pcm_hw_params_set_period_size_near(pcm_handle, params, &frames, NULL)) < 0)
+	{
+		fprintf(stderr, "cannot set period size (%s)\n", snd_strerror(err));
+		exit(1);
+	}
+	frames = buffer_size;
+	if (buffer_size > 0 && (err = snd_pcm_hw_params_set_buffer_size_near(pcm_handle, params, &frames)) < 0)
+	{
+		fprintf(stderr, "cannot set buffer size (%s)\n", snd_strerror(err));
+		exit(1);
+	}
 	if ((err = snd_pcm_hw_params(pcm_handle, params)) < 0)
 	{
 		fprintf(stderr, "cannot set parameters (%s)\n", snd_strerror(err));
@@ -69,12 +84,65 @@ Microphone::Microphone(std::string device)
 	return;
 }
 
-Microphone::~Microphone()
+void Microphone::Capture()
 {
-	// close audio device
-	fprintf(stderr, "\tReleasing audio device\n");
-	snd_pcm_drain(this->pcm_handle);
-	snd_pcm_close(this->pcm_handle);
+	if (this->access == MMapCaptureAccessType)
+	{
+		this->CaptureMMap();
+		return;
+	}
+	short buffer[CAPTURE_CHUNK_SIZE];
+	while (this->capturing.load(std::memory_order_relaxed))
+	{
+		int err = snd_pcm_readi(this->pcm_handle, buffer, CAPTURE_CHUNK_SIZE);
+		if (err < 0)
+		{
+			this->Recover(err);
+			continue;
+		}
+		this->Write(buffer, err);
+	}
+	return;
+}
+
+void Microphone::CaptureMMap()
+{
+	// copy straight from the dma area into the sample ring (no intermediate buffer, no read syscall)
+	while (this->capturing.load(std::memory_order_relaxed))
+	{
+		int err = 0;
+		// capture streams are not started implicitly in mmap mode
+		if (snd_pcm_state(this->pcm_handle) == SND_PCM_STATE_PREPARED && (err = snd_pcm_start(this->pcm_handle)) < 0)
+		{
+			this->Recover(err);
+			continue;
+		}
+		snd_pcm_sframes_t available = snd_pcm_avail_update(this->pcm_handle);
+		if (available < 0)
+		{
+			this->Recover(available);
+			continue;
+		}
+		if (available == 0)
+		{
+			if ((err = snd_pcm_wait(this->pcm_handle, CAPTURE_WAIT_TIMEOUT)) < 0)
+				this->Recover(err);
+			continue;
+		}
+		const snd_pcm_channel_area_t* areas = NULL;
+		snd_pcm_uframes_t offset = 0, frames = available;
+		if ((err = snd_pcm_mmap_begin(this->pcm_handle, &areas, &offset, &frames)) < 0)
+		{
+			this->Recover(err);
+			continue;
+		}
+		// mono s16: one contiguous run of samples (frames may stop short at the end of the dma buffer)
+		const short* samples = (const short*)((const char*)areas[0].addr + (areas[0].first + offset * areas[0].step) / 8);
+		this->Write(samples, frames);
+		snd_pcm_sframes_t committed = snd_pcm_mmap_commit(this->pcm_handle, offset, frames);
+		if (committed < 0 || (snd_pcm_uframes_t)committed != frames)
+			this->Recover(committed >= 0 ? -EPIPE : committed);
+	}
 	return;
 }
 
@@ -82,4 +150,28 @@ int Microphone::GetData(short* buffer, int buffer_size)
 {
 	int err = snd_pcm_readi(this->pcm_handle, buffer, buffer_size);
 	return err;
+}
+
+bool Microphone::Recover(int err)
+{
+	// overrun (or suspend), re-prepare the device and keep going
+	if (err == -EPIPE)
+		this->overruns.fetch_add(1, std::memory_order_relaxed);
+	if ((err = snd_pcm_recover(this->pcm_handle, err, 1)) < 0)
+	{
+		fprintf(stderr, "audio capture failed (%s)\n", snd_strerror(err));
+		this->capturing = false;
+		return false;
+	}
+	return true;
+}
+
+Microphone::~Microphone()
+{
+	this->Stop();
+	// close audio device
+	fprintf(stderr, "\tReleasing audio device\n");
+	snd_pcm_drain(this->pcm_handle);
+	snd_pcm_close(this->pcm_handle);
+	return;
 }
\ No newline at end of file
@@ -1,23 +1,34 @@
 #pragma once
 
 #include <alsa/asoundlib.h>
-#include <sndfile.h>
 #include <stdexcept>
 
 #include <sstream>
 
-// capture sample rate
-#define SAMP_RATE 11025
+#include "AudioSource.h"
 
-class Microphone
+// longest wait for the device in mmap mode (ms)
+#define CAPTURE_WAIT_TIMEOUT 100
+
+enum CaptureAccessTypes { ReadCaptureAccessType = 0, MMapCaptureAccessType = 1 };
+
+// live alsa capture
+class Microphone : public AudioSource
 {
 
 public:
-	Microphone(std::string device);
+	Microphone(std::string device, CaptureAccessTypes access = ReadCaptureAccessType, int period_size = 0, int buffer_size = 0);
 	~Microphone();
 
 	int GetData(short* buffer, int buffer_size);
 
+protected:
+	void Capture();
+
 private:
 	snd_pcm_t * pcm_handle;
-};
\ No newline at end of file
+	CaptureAccessTypes access;
+
+	void CaptureMMap();
+	bool Recover(int err);
+};
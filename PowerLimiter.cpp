@@ -0,0 +1,80 @@
+#include "PowerLimiter.h"
+
+using namespace std;
+
+PowerLimiter::PowerLimiter(int max_level, int brightness)
+{
+	if (max_level < 0 || max_level > 255 || brightness < 1 || brightness > 100)
+		throw invalid_argument("Invalid power limiter parameters");
+	// brightness scales the color level before the luminance curve
+	for (int percent = 0; percent <= 100; percent++)
+	{
+		for (int value = 0; value < 256; value++)
+		{
+			this->drive[percent][value] = LuminanceCIE1931((float)value * percent / 255.0);
+		}
+	}
+	this->budget = LuminanceCIE1931(100.0 * max_level / 255.0);
+	this->maxBrightness = brightness;
+	this->brightness = brightness;
+	this->lowestBrightness = brightness;
+	this->limitedFrames = 0;
+	return;
+}
+
+float PowerLimiter::GetCurrent(const uint32_t* levels, int brightness) const
+{
+	const float* drive = this->drive[brightness];
+	double total = 0.0;
+	unsigned long channels = 0;
+	for (int value = 0; value < 256; value++)
+	{
+		if (levels[value] == 0)
+			continue;
+		total += (double)levels[value] * drive[value];
+		channels += levels[value];
+	}
+	return channels > 0 ? total / channels : 0.0;
+}
+
+void PowerLimiter::PrintStats() const
+{
+	fprintf(stderr, "Power limiter lowered brightness on %lu frames (down to %d%%)\n", this->limitedFrames, this->lowestBrightness);
+	return;
+}
+
+int PowerLimiter::Update(const uint32_t* levels)
+{
+	// brightest setting that keeps the frame within budget (drive only grows with brightness)
+	int target = this->maxBrightness;
+	if (this->GetCurrent(levels, target) > this->budget)
+	{
+		int low = 1, high = target - 1;
+		target = 1;
+		while (low <= high)
+		{
+			int middle = (low + high) / 2;
+			if (this->GetCurrent(levels, middle) <= this->budget)
+			{
+				target = middle;
+				low = middle + 1;
+			}
+			else
+			{
+				high = middle - 1;
+			}
+		}
+	}
+	if (target < this->maxBrightness)
+		this->limitedFrames++;
+	// lower at once, raise only once there is some headroom (every change repaints the next canvas)
+	if (target < this->brightness || target >= this->brightness + POWER_LIMIT_HYSTERESIS || target == this->maxBrightness)
+		this->brightness = target;
+	this->lowestBrightness = this->brightness < this->lowestBrightness ? this->brightness : this->lowestBrightness;
+	return this->brightness;
+}
+
+PowerLimiter::~PowerLimiter()
+{
+	return;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <math.h>
+#include <stdexcept>
+#include <stdint.h>
+#include <stdio.h>
+
+// brightness steps the limiter must gain before raising the brightness again (lowering is immediate)
+#define POWER_LIMIT_HYSTERESIS 5
+
+// relative led drive (0.0 -> 1.0) at a perceived level in percent, the CIE1931 curve the matrix library maps colors with
+// (a channel value c at brightness b is driven at LuminanceCIE1931(c * b / 255))
+inline float LuminanceCIE1931(float percent)
+{
+	return percent <= 8.0 ? percent / 902.3 : pow((percent + 16.0) / 116.0, 3);
+}
+
+// keeps the estimated drive current of each frame within a budget by lowering the panel brightness of the next one
+class PowerLimiter
+{
+public:
+	// max_level: every frame may draw at most the current of a full white frame at this color level (0 -> 255)
+	// brightness: panel brightness in percent when under budget (1 -> 100)
+	PowerLimiter(int max_level, int brightness);
+	~PowerLimiter();
+
+	float GetBudget() const
+	{
+		return this->budget;
+	}
+	int GetBrightness() const
+	{
+		return this->brightness;
+	}
+	// average drive per channel (relative to full on, same units as the budget) of a frame at the given brightness
+	// levels: how many channels show each value (see DirtyTracker::GetLevels)
+	float GetCurrent(const uint32_t* levels, int brightness) const;
+	unsigned long GetLimitedFrames() const
+	{
+		return this->limitedFrames;
+	}
+	void PrintStats() const;
+	// levels of the frame just finished, returns the brightness for the next one
+	int Update(const uint32_t* levels);
+
+private:
+	float budget;
+	int maxBrightness;
+	int brightness;
+	int lowestBrightness;
+	unsigned long limitedFrames;
+	// drive of each channel value at each brightness
+	float drive[101][256];
+};
@@ -0,0 +1,39 @@
+#include "STFT.h"
+
+using namespace std;
+
+STFT::STFT(int log, int hop)
+{
+	this->size = 1 << log;
+	if (hop < 1 || hop > this->size)
+		throw invalid_argument("STFT hop must be between 1 and the fft size!");
+	this->hop = hop;
+	this->samples = new short[2 * this->size];
+	this->Clear();
+	return;
+}
+
+void STFT::Clear()
+{
+	this->head = 0;
+	memset(this->samples, 0, sizeof(short) * 2 * this->size);
+	return;
+}
+
+short* STFT::Push(const short* samples)
+{
+	// overwrite the oldest hop of samples (and its mirror)
+	for (int i = 0; i < this->hop; i++)
+	{
+		this->samples[this->head] = this->samples[this->head + this->size] = samples[i];
+		this->head = this->head + 1 == this->size ? 0 : this->head + 1;
+	}
+	// oldest sample first
+	return this->samples + this->head;
+}
+
+STFT::~STFT()
+{
+	delete[] this->samples;
+	return;
+}
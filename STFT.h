@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cassert>
+#include <stdexcept>
+#include <string.h>
+
+// sliding analysis window over the sample stream, advanced one hop at a time
+class STFT
+{
+public:
+	STFT(int log, int hop);
+	~STFT();
+
+	void Clear();
+	int GetHop() const
+	{
+		return this->hop;
+	}
+	int GetSize() const
+	{
+		return this->size;
+	}
+	short* Push(const short* samples);
+
+private:
+	int size;
+	int hop;
+	int head;
+	// every sample is written twice (head and head + size) so the newest window is always contiguous
+	short* samples;
+};
@@ -0,0 +1,73 @@
+#include "SampleRing.h"
+
+using namespace std;
+
+SampleRing::SampleRing(int capacity)
+{
+	if (capacity < 1 || (capacity & (capacity - 1)) != 0)
+		throw invalid_argument("Sample ring capacity must be a power of two!");
+	this->capacity = capacity;
+	this->mask = capacity - 1;
+	this->samples = new short[capacity];
+	this->writeIndex.store(0);
+	this->readIndex.store(0);
+	this->dropped.store(0);
+	return;
+}
+
+int SampleRing::Discard(int keep)
+{
+	// skip the oldest samples so at most 'keep' remain (consumer catching up)
+	unsigned int read = this->readIndex.load(memory_order_relaxed);
+	unsigned int write = this->writeIndex.load(memory_order_acquire);
+	int available = (int)(write - read);
+	if (available <= keep)
+		return 0;
+	int skipped = available - keep;
+	this->readIndex.store(read + skipped, memory_order_release);
+	this->dropped.fetch_add(skipped, memory_order_relaxed);
+	return skipped;
+}
+
+int SampleRing::GetAvailable() const
+{
+	return (int)(this->writeIndex.load(memory_order_acquire) - this->readIndex.load(memory_order_acquire));
+}
+
+bool SampleRing::Read(short* buffer, int count)
+{
+	// all or nothing, never blocks
+	unsigned int read = this->readIndex.load(memory_order_relaxed);
+	unsigned int write = this->writeIndex.load(memory_order_acquire);
+	if ((int)(write - read) < count)
+		return false;
+	unsigned int start = read & this->mask;
+	int first = min(count, this->capacity - (int)start);
+	memcpy(buffer, this->samples + start, sizeof(short) * first);
+	memcpy(buffer + first, this->samples, sizeof(short) * (count - first));
+	this->readIndex.store(read + count, memory_order_release);
+	return true;
+}
+
+int SampleRing::Write(const short* buffer, int count)
+{
+	// copy what fits, count the rest as dropped
+	unsigned int write = this->writeIndex.load(memory_order_relaxed);
+	unsigned int read = this->readIndex.load(memory_order_acquire);
+	int space = this->capacity - (int)(write - read);
+	int written = min(count, space);
+	unsigned int start = write & this->mask;
+	int first = min(written, this->capacity - (int)start);
+	memcpy(this->samples + start, buffer, sizeof(short) * first);
+	memcpy(this->samples, buffer + first, sizeof(short) * (written - first));
+	this->writeIndex.store(write + written, memory_order_release);
+	if (written < count)
+		this->dropped.fetch_add(count - written, memory_order_relaxed);
+	return written;
+}
+
+SampleRing::~SampleRing()
+{
+	delete[] this->samples;
+	return;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+#include <string.h>
+
+// cache line size used to keep the producer and consumer indices apart
+#define SAMPLE_RING_ALIGNMENT 64
+
+// lock-free single producer / single consumer ring of audio samples
+class SampleRing
+{
+public:
+	SampleRing(int capacity);
+	~SampleRing();
+
+	// consumer side
+	int Discard(int keep);
+	int GetAvailable() const;
+	bool Read(short* buffer, int count);
+
+	// producer side
+	int Write(const short* buffer, int count);
+
+	int GetCapacity() const
+	{
+		return this->capacity;
+	}
+	unsigned long GetDropped() const
+	{
+		return this->dropped.load(std::memory_order_relaxed);
+	}
+
+private:
+	int capacity;
+	unsigned int mask;
+	short* samples;
+	// free running sample counters (wrap naturally, masked on access), padded onto separate cache lines
+	char producerPadding[SAMPLE_RING_ALIGNMENT];
+	std::atomic<unsigned int> writeIndex;
+	char consumerPadding[SAMPLE_RING_ALIGNMENT];
+	std::atomic<unsigned int> readIndex;
+	char counterPadding[SAMPLE_RING_ALIGNMENT];
+	// samples lost to a full ring (producer) or skipped to catch up (consumer)
+	std::atomic<unsigned long> dropped;
+};
@@ -0,0 +1,93 @@
+#include "SyntheticAudioSource.h"
+
+using namespace std;
+
+// length of one sweep before it restarts (seconds)
+#define SWEEP_DURATION 10.0
+// length of each click (samples)
+#define CLICK_LENGTH 16
+
+SyntheticAudioSource::SyntheticAudioSource(SyntheticSignalTypes type, float frequency, float end_frequency, float amplitude, float duration, bool real_time) : AudioSource(real_time)
+{
+	if (frequency <= 0.0 || (type == SweepSyntheticSignalType && end_frequency <= 0.0))
+		throw invalid_argument("Synthetic signal frequencies must be positive!");
+	this->type = type;
+	this->frequency = frequency;
+	this->endFrequency = end_frequency;
+	this->amplitude = fmin(fmax(amplitude, 0.0), 1.0) * 32767.0;
+	this->sampleCount = (long)(duration * SAMP_RATE);
+	return;
+}
+
+void SyntheticAudioSource::Capture()
+{
+	short samples[CAPTURE_CHUNK_SIZE];
+	struct timespec deadline;
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+	long index = 0;
+	while (this->capturing.load(memory_order_relaxed))
+	{
+		int count = CAPTURE_CHUNK_SIZE;
+		if (this->sampleCount > 0)
+		{
+			if (index >= this->sampleCount)
+				break;
+			count = (int)fmin(count, this->sampleCount - index);
+		}
+		for (int i = 0; i < count; i++)
+		{
+			samples[i] = this->Generate(index + i);
+		}
+		this->Write(samples, count);
+		this->Pace(deadline, count);
+		index += count;
+	}
+	// end of signal
+	this->capturing = false;
+	return;
+}
+
+short SyntheticAudioSource::Generate(long index)
+{
+	double seconds = (double)index / (double)SAMP_RATE;
+	double value = 0.0;
+	switch (this->type)
+	{
+		case SweepSyntheticSignalType:
+		{
+			// exponential sweep from frequency to end frequency, phase continuous within each sweep
+			double t = fmod(seconds, SWEEP_DURATION);
+			double rate = log(this->endFrequency / this->frequency) / SWEEP_DURATION;
+			double phase = fabs(rate) < 1e-9 ? this->frequency * t : this->frequency * (exp(rate * t) - 1.0) / rate;
+			value = sin(2.0 * M_PI * phase);
+			break;
+		}
+		case NoiseSyntheticSignalType:
+		{
+			// white noise from a hash of the sample index (same sequence every run)
+			uint32_t hash = (uint32_t)index * 2654435761u;
+			hash ^= hash >> 16;
+			hash *= 2246822519u;
+			hash ^= hash >> 13;
+			value = (double)(hash & 0xFFFF) / 32767.5 - 1.0;
+			break;
+		}
+		case ClickSyntheticSignalType:
+		{
+			long period = (long)(SAMP_RATE / this->frequency);
+			value = period > 0 && index % period < CLICK_LENGTH ? 1.0 : 0.0;
+			break;
+		}
+		default:
+		case ToneSyntheticSignalType:
+			value = sin(2.0 * M_PI * this->frequency * seconds);
+			break;
+	}
+	return (short)(this->amplitude * value);
+}
+
+SyntheticAudioSource::~SyntheticAudioSource()
+{
+	this->Stop();
+	return;
+}
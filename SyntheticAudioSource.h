@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cmath>
+#include <math.h>
+#include <stdexcept>
+#include <stdint.h>
+
+#include "AudioSource.h"
+
+enum SyntheticSignalTypes { ToneSyntheticSignalType = 0, SweepSyntheticSignalType = 1, NoiseSyntheticSignalType = 2, ClickSyntheticSignalType = 3 };
+
+// generated test signals (repeatable, no hardware required)
+class SyntheticAudioSource : public AudioSource
+{
+public:
+	// frequency: tone frequency, sweep start or clicks per second; end_frequency: sweep end; duration 0 = endless
+	SyntheticAudioSource(SyntheticSignalTypes type, float frequency, float end_frequency, float amplitude, float duration, bool real_time = true);
+	~SyntheticAudioSource();
+
+	short Generate(long index);
+
+protected:
+	void Capture();
+
+private:
+	SyntheticSignalTypes type;
+	float frequency;
+	float endFrequency;
+	float amplitude;
+	long sampleCount;
+};
@@ -0,0 +1,41 @@
+#include "TransferFunction.h"
+
+TransferFunction::TransferFunction(double numerator, double offset, double slope)
+{
+	// build db thresholds from libm so lookups match (int)(20log10(value)) exactly
+	for (int decibels = 0; decibels <= MAX_DECIBELS; decibels++)
+	{
+		double threshold = ceil(pow(10.0, (double)decibels / 20.0));
+		while (threshold > 1.0 && 20.0 * log10(threshold - 1.0) >= decibels)
+			threshold -= 1.0;
+		while (20.0 * log10(threshold) < decibels)
+			threshold += 1.0;
+		this->decibelThresholds[decibels] = (int)threshold;
+	}
+	for (int bit = 0; bit < 32; bit++)
+	{
+		this->octaveDecibels[bit] = (int)(20.0 * log10(pow(2.0, bit)));
+	}
+	this->SetSigmoid(numerator, offset, slope);
+	return;
+}
+
+void TransferFunction::SetSigmoid(double numerator, double offset, double slope)
+{
+	this->numerator = numerator;
+	this->offset = offset;
+	this->slope = slope;
+	for (int i = 0; i < SIGMOID_TABLE_SIZE; i++)
+	{
+		this->sigmoidTable[i] = (int)this->SigmoidFunction((double)i);
+	}
+	return;
+}
+
+double TransferFunction::SigmoidFunction(double value) const
+{
+	/* in order to approach a desired full scale value, the left-hand side constant (in the demoninator)
+	needs to be equal to the numerator divided by the desired full scale */
+	double constant = this->numerator / FULL_SCALE;
+	return this->numerator / (constant + pow(M_E, -1.0*((value - this->offset) / this->slope)));
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cmath>
+#include <math.h>
+
+#define FULL_SCALE 100.0
+// sigmoid numerator value
+// with logarithmic also enabled, decreasing this value allows you to stretch the sigmoid shape along the x-axis
+#define SIGMOID_NUMERATOR 10.0
+// sigmoid X offset (higher = more low frequency attenuation, more amplitude required to hit gain threshold)
+// with logarithmic also enabled, increasing this number will exponentially increase the amount of amplitude required to hit full scale db
+#define SIGMOID_OFFSET 25.0
+// sigmoid sloep (higher = slopes slower, less effect of attenuation/gain)
+// with logarithmic also enabled, increasing this number will result in a sharper corner and a closer resemblance to the 20log10 function
+// *** this parameter is of great interest
+#define SIGMOID_SLOPE 12.0
+
+// largest integer db value of a positive int (20log10(2^31 - 1) = 186.6)
+#define MAX_DECIBELS 186
+// sigmoid inputs covered by the lookup table (larger inputs are computed directly)
+#define SIGMOID_TABLE_SIZE 256
+
+// table driven 20log10 and sigmoid transfer functions (no transcendental calls per bin)
+class TransferFunction
+{
+public:
+	TransferFunction(double numerator = SIGMOID_NUMERATOR, double offset = SIGMOID_OFFSET, double slope = SIGMOID_SLOPE);
+
+	// (int)(20log10(value)), 0 for non-positive values
+	int Decibels(int value) const
+	{
+		if (value <= 0)
+			return 0;
+		int decibels = this->octaveDecibels[31 - __builtin_clz(value)];
+		while (decibels < MAX_DECIBELS && this->decibelThresholds[decibels + 1] <= value)
+			decibels++;
+		return decibels;
+	}
+
+	// (int)SigmoidFunction(value)
+	int Sigmoid(int value) const
+	{
+		if (value >= 0 && value < SIGMOID_TABLE_SIZE)
+			return this->sigmoidTable[value];
+		return (int)this->SigmoidFunction((double)value);
+	}
+
+	void SetSigmoid(double numerator, double offset, double slope);
+	double SigmoidFunction(double value) const;
+
+private:
+	double numerator;
+	double offset;
+	double slope;
+	// smallest value reaching each integer db
+	int decibelThresholds[MAX_DECIBELS + 1];
+	// integer db of each power of two
+	int octaveDecibels[32];
+	int sigmoidTable[SIGMOID_TABLE_SIZE];
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+
+// cache line size used to keep the shared slot index away from either side's state
+#define TRIPLE_BUFFER_ALIGNMENT 64
+// set in the shared index while it holds a slot the consumer has not seen
+#define TRIPLE_BUFFER_FRESH 4
+
+// lock-free single producer / single consumer handoff of the newest value (older unread values are overwritten)
+template <typename T>
+class TripleBuffer
+{
+public:
+	TripleBuffer()
+	{
+		this->back = 0;
+		this->middle = 1;
+		this->front = 2;
+		return;
+	}
+
+	// producer side: fill the back slot, then publish it
+	T& GetBack()
+	{
+		return this->slots[this->back];
+	}
+	void Publish()
+	{
+		this->back = this->middle.exchange(this->back | TRIPLE_BUFFER_FRESH, std::memory_order_acq_rel) & ~TRIPLE_BUFFER_FRESH;
+		return;
+	}
+
+	// consumer side: take the newest published slot (false if nothing new)
+	const T& GetFront() const
+	{
+		return this->slots[this->front];
+	}
+	bool Update()
+	{
+		if (!(this->middle.load(std::memory_order_relaxed) & TRIPLE_BUFFER_FRESH))
+			return false;
+		this->front = this->middle.exchange(this->front, std::memory_order_acq_rel) & ~TRIPLE_BUFFER_FRESH;
+		return true;
+	}
+
+private:
+	T slots[3];
+	int back;
+	char producerPadding[TRIPLE_BUFFER_ALIGNMENT];
+	std::atomic<int> middle;
+	char consumerPadding[TRIPLE_BUFFER_ALIGNMENT];
+	int front;
+};
@@ -0,0 +1,201 @@
+#include "VirtualMatrix.h"
+
+using namespace rgb_matrix;
+using namespace std;
+
+VirtualCanvas::VirtualCanvas(int width, int height)
+{
+	if (width < 1 || height < 1)
+		throw invalid_argument("Invalid virtual canvas dimensions");
+	this->canvasWidth = width;
+	this->canvasHeight = height;
+	this->data = new uint8_t[3 * width * height];
+	this->Clear();
+	return;
+}
+
+void VirtualCanvas::Clear()
+{
+	memset(this->data, 0, 3 * this->canvasWidth * this->canvasHeight);
+	return;
+}
+
+void VirtualCanvas::Fill(uint8_t red, uint8_t green, uint8_t blue)
+{
+	for (int i = 0; i < this->canvasWidth * this->canvasHeight; i++)
+	{
+		this->data[3 * i] = red;
+		this->data[3 * i + 1] = green;
+		this->data[3 * i + 2] = blue;
+	}
+	return;
+}
+
+void VirtualCanvas::SetPixel(int x, int y, uint8_t red, uint8_t green, uint8_t blue)
+{
+	// same clipping as the hardware framebuffer
+	if (x < 0 || y < 0 || x >= this->canvasWidth || y >= this->canvasHeight)
+		return;
+	uint8_t* pixel = this->data + 3 * (y * this->canvasWidth + x);
+	pixel[0] = red;
+	pixel[1] = green;
+	pixel[2] = blue;
+	return;
+}
+
+void VirtualCanvas::SetPixels(int x, int y, int count, const uint8_t* rgb)
+{
+	if (y < 0 || y >= this->canvasHeight)
+		return;
+	// clip the run to the row
+	if (x < 0)
+	{
+		count += x;
+		rgb -= 3 * x;
+		x = 0;
+	}
+	if (x + count > this->canvasWidth)
+		count = this->canvasWidth - x;
+	if (count > 0)
+		memcpy(this->data + 3 * (y * this->canvasWidth + x), rgb, 3 * count);
+	return;
+}
+
+VirtualCanvas::~VirtualCanvas()
+{
+	delete[] this->data;
+	return;
+}
+
+// numbered sequence path as a format taking exactly one unsigned long
+static string SequenceFormat(const string& output)
+{
+	string format;
+	int conversions = 0;
+	for (size_t i = 0; i < output.size(); i++)
+	{
+		format += output[i];
+		if (output[i] != '%')
+			continue;
+		size_t j = i + 1;
+		if (j < output.size() && output[j] == '%')
+		{
+			format += '%';
+			i = j;
+			continue;
+		}
+		// keep flags, width and precision, replace the length with 'l'
+		while (j < output.size() && strchr("-+ #0123456789.", output[j]) != NULL)
+			format += output[j++];
+		while (j < output.size() && strchr("hljzt", output[j]) != NULL)
+			j++;
+		if (j >= output.size() || strchr("diuoxX", output[j]) == NULL)
+			throw invalid_argument("Virtual matrix output '" + output + "' has an unsupported conversion");
+		format += 'l';
+		format += output[j] == 'd' || output[j] == 'i' ? 'u' : output[j];
+		conversions++;
+		i = j;
+	}
+	if (conversions != 1)
+		throw invalid_argument("Virtual matrix output '" + output + "' must contain exactly one frame number conversion");
+	return format;
+}
+
+VirtualMatrix::VirtualMatrix(int width, int height, const string& output, VirtualOutputTypes format)
+{
+	this->front = new VirtualCanvas(width, height);
+	this->back = new VirtualCanvas(width, height);
+	this->output = output;
+	this->format = format;
+	this->stream = NULL;
+	this->pipe = false;
+	this->frameCount = 0;
+	// one stream for every frame unless the path is a numbered sequence
+	if (output.empty())
+		return;
+	if (output[0] == '|')
+	{
+		this->stream = popen(output.c_str() + 1, "w");
+		this->pipe = true;
+	}
+	else if (output.find('%') != string::npos)
+	{
+		this->sequence = SequenceFormat(output);
+		return;
+	}
+	else
+	{
+		this->stream = fopen(output.c_str(), "wb");
+	}
+	if (this->stream == NULL)
+		throw runtime_error("Failed to open virtual matrix output '" + output + "'");
+	return;
+}
+
+void VirtualMatrix::Clear()
+{
+	this->front->Clear();
+	return;
+}
+
+Canvas* VirtualMatrix::GetOffscreen()
+{
+	return this->back;
+}
+
+Canvas* VirtualMatrix::Swap(int vsync_fraction)
+{
+	// no refresh to wait for, present immediately
+	VirtualCanvas* presented = this->back;
+	this->back = this->front;
+	this->front = presented;
+	this->frameCount++;
+	this->Write();
+	return this->back;
+}
+
+Canvas* VirtualMatrix::TrySwap(int vsync_fraction)
+{
+	// never has to wait
+	return this->Swap(vsync_fraction);
+}
+
+void VirtualMatrix::Write()
+{
+	if (this->output.empty())
+		return;
+	FILE* file = this->stream;
+	if (file == NULL)
+	{
+		// numbered sequence, one file per frame
+		char path[VIRTUAL_PATH_SIZE];
+		snprintf(path, sizeof(path), this->sequence.c_str(), this->frameCount);
+		if ((file = fopen(path, "wb")) == NULL)
+			throw runtime_error(string("Failed to open virtual matrix frame '") + path + "'");
+	}
+	int width = this->front->width();
+	int height = this->front->height();
+	bool written = true;
+	if (this->format == PPMVirtualOutputType)
+		written = fprintf(file, "P6\n%d %d\n255\n", width, height) > 0;
+	written = written && fwrite(this->front->GetData(), 3 * width, height, file) == (size_t)height;
+	if (file != this->stream)
+		fclose(file);
+	if (!written)
+		throw runtime_error("Failed to write virtual matrix frame");
+	return;
+}
+
+VirtualMatrix::~VirtualMatrix()
+{
+	if (this->stream != NULL)
+	{
+		if (this->pipe)
+			pclose(this->stream);
+		else
+			fclose(this->stream);
+	}
+	delete this->front;
+	delete this->back;
+	return;
+}
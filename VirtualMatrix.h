@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include <stdexcept>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+#include "MatrixBackend.h"
+
+// longest expanded output path (ppm sequences)
+#define VIRTUAL_PATH_SIZE 4096
+
+enum VirtualOutputTypes { PPMVirtualOutputType = 0, RawVirtualOutputType = 1 };
+
+// in-memory rgb888 canvas (row major, top left first)
+class VirtualCanvas : public rgb_matrix::Canvas
+{
+
+public:
+	VirtualCanvas(int width, int height);
+	~VirtualCanvas();
+
+	void Clear();
+	void Fill(uint8_t red, uint8_t green, uint8_t blue);
+	const uint8_t* GetData() const
+	{
+		return this->data;
+	}
+	int height() const
+	{
+		return this->canvasHeight;
+	}
+	void SetPixel(int x, int y, uint8_t red, uint8_t green, uint8_t blue);
+	void SetPixels(int x, int y, int count, const uint8_t* rgb);
+	int width() const
+	{
+		return this->canvasWidth;
+	}
+
+private:
+	int canvasWidth;
+	int canvasHeight;
+	uint8_t* data;
+};
+
+// panels simulated in memory, each presented frame optionally written out as ppm images or a raw rgb24 stream
+class VirtualMatrix : public MatrixBackend
+{
+
+public:
+	// output: "" (none), a file, a numbered file sequence (one integer conversion, e.g. "%06d") or "| command" (pipe)
+	VirtualMatrix(int width, int height, const std::string& output = "", VirtualOutputTypes format = PPMVirtualOutputType);
+	~VirtualMatrix();
+
+	void Clear();
+	// last presented frame
+	const uint8_t* GetFrame() const
+	{
+		return this->front->GetData();
+	}
+	unsigned long GetFrameCount() const
+	{
+		return this->frameCount;
+	}
+	const char* GetName()
+	{
+		return "virtual";
+	}
+	rgb_matrix::Canvas* GetOffscreen();
+	bool SetBrightness(int percent)
+	{
+		// frames are stored as drawn, there is no drive current to limit
+		return false;
+	}
+	rgb_matrix::Canvas* Swap(int vsync_fraction);
+	rgb_matrix::Canvas* TrySwap(int vsync_fraction);
+
+private:
+	VirtualCanvas* front;
+	VirtualCanvas* back;
+	std::string output;
+	// validated printf format of a numbered sequence
+	std::string sequence;
+	VirtualOutputTypes format;
+	FILE* stream;
+	bool pipe;
+	unsigned long frameCount;
+
+	void Write();
+};
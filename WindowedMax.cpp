@@ -0,0 +1,59 @@
+#include "WindowedMax.h"
+
+WindowedMax::WindowedMax(int window)
+{
+	assert(window > 0);
+	this->window = window;
+	this->capacity = window + 1;
+	this->frames = new long[this->capacity];
+	this->values = new int[this->capacity];
+	this->Clear();
+	return;
+}
+
+void WindowedMax::Clear()
+{
+	this->head = 0;
+	this->size = 0;
+	this->frame = 0;
+	return;
+}
+
+int WindowedMax::Get() const
+{
+	// empty window reads as zero (same as a history of silent frames)
+	if (this->size == 0)
+		return 0;
+	return this->values[this->head];
+}
+
+void WindowedMax::Push(int value)
+{
+	this->frame++;
+	// drop entries from the back that can never be the max again
+	while (this->size > 0)
+	{
+		int back = (this->head + this->size - 1) % this->capacity;
+		if (this->values[back] > value)
+			break;
+		this->size--;
+	}
+	int tail = (this->head + this->size) % this->capacity;
+	this->frames[tail] = this->frame;
+	this->values[tail] = value;
+	this->size++;
+	// drop entries from the front that left the window
+	while (this->frames[this->head] <= this->frame - this->window)
+	{
+		this->head = (this->head + 1) % this->capacity;
+		this->size--;
+	}
+	return;
+}
+
+WindowedMax::~WindowedMax()
+{
+	delete[] this->frames;
+	delete[] this->values;
+	return;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cassert>
+
+// running maximum over the last 'window' pushed values (monotonic deque, amortized O(1) per push)
+class WindowedMax
+{
+public:
+	WindowedMax(int window);
+	~WindowedMax();
+
+	void Clear();
+	int Get() const;
+	void Push(int value);
+
+private:
+	int window;
+	int capacity;
+	int head;
+	int size;
+	long frame;
+	// deque of (frame, value) with strictly decreasing values from front to back
+	long* frames;
+	int* values;
+};
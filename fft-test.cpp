@@ -1,19 +1,481 @@
+#include <algorithm>
 #include <cstdint>
 #include <iostream>
 #include <stdexcept>
+#include <thread>
+#include <unistd.h>
 
+#include "Compositor.h"
 #include "FFT.h"
+#include "FrameScheduler.h"
+#include "PowerLimiter.h"
+#include "SampleRing.h"
+#include "STFT.h"
+#include "SyntheticAudioSource.h"
+#include "TripleBuffer.h"
+#include "VirtualMatrix.h"
 
 #define SAMP_RATE 11025
 #define FFT_LOG 9
 // # of frequency bins
 #define BIN_COUNT 16
+// history count for each frequency bin (for normalization)
+#define TOTAL_BIN_DEPTH 64
+// history count for each frequency bin (for display)
+#define BIN_DEPTH 8
+// # of analysis frames to run through the full path
+#define FRAME_COUNT 256
+// color gains the full path settles on after FRAME_COUNT frames
+#define EXPECTED_RED_GAIN 1.1025
+#define EXPECTED_GREEN_GAIN 1.96
+#define EXPECTED_BLUE_GAIN 0.98
+#define MAX_GAIN_ERROR 1e-4
+// samples between overlapping stft frames
+#define STFT_HOP 128
+// samples pushed through the capture ring by the producer thread
+#define RING_SAMPLE_COUNT (1 << 20)
+// maximum cpu fft error relative to the spectrum peak
+#define MAX_RELATIVE_ERROR 1e-4
+// panel size for the virtual matrix check (2x2 panels)
+#define PANEL_SIZE 32
+// frame rate for the scheduler check
+#define SCHEDULER_FPS 100.0
 
 using namespace std;
 
 int main(int argc, char** argv)
 {
-	FFT * fft = new FFT(FFT_LOG, SAMP_RATE);
+	int full_count = 1 << FFT_LOG;
+	int failures = 0;
+
+	// compare cpu backend against a direct dft (same direction as the analysis path)
+	FFTBackend* backend = FFTBackend::Create(CPUFFTBackendType, FFT_LOG, GPU_FFT_REV);
+	GPU_FFT_COMPLEX* in = backend->GetInput();
+	GPU_FFT_COMPLEX* out = backend->GetOutput();
+	for (int i = 0; i < full_count; i++)
+	{
+		in[i].re = 1000.0 * sin(2.0 * GPU_FFT_PI * 37.0 * i / full_count) + (float)((i * 7919) % 201 - 100);
+		in[i].im = 250.0 * cos(2.0 * GPU_FFT_PI * 5.0 * i / full_count);
+	}
+	backend->Execute();
+	double max_error = 0.0, peak = 0.0;
+	for (int k = 0; k < full_count; k++)
+	{
+		double re = 0.0, im = 0.0;
+		for (int n = 0; n < full_count; n++)
+		{
+			double angle = 2.0 * GPU_FFT_PI * (double)(((long)k * n) % full_count) / full_count;
+			re += in[n].re * cos(angle) - in[n].im * sin(angle);
+			im += in[n].re * sin(angle) + in[n].im * cos(angle);
+		}
+		max_error = fmax(max_error, hypot(out[k].re - re, out[k].im - im));
+		peak = fmax(peak, hypot(re, im));
+	}
+	fprintf(stderr, "CPU FFT relative error: %g\n", max_error / peak);
+	if (max_error / peak > MAX_RELATIVE_ERROR)
+	{
+		fprintf(stderr, "\tFAILED\n");
+		failures++;
+	}
+	delete backend;
+
+	// compare real input (half size) path against the full complex transform
+	FFT * complex_fft = new FFT(FFT_LOG, SAMP_RATE, CPUFFTBackendType, false);
+	FFT * real_fft = new FFT(FFT_LOG, SAMP_RATE, CPUFFTBackendType, true);
+	short buffer[full_count];
+	for (int i = 0; i < full_count; i++)
+	{
+		buffer[i] = (short)(8000.0 * sin(2.0 * GPU_FFT_PI * 21.0 * i / full_count) + (i * 7919) % 2001 - 1000);
+	}
+	GPU_FFT_COMPLEX* complex_out = complex_fft->Transform(buffer);
+	GPU_FFT_COMPLEX* real_out = real_fft->Transform(buffer);
+	max_error = 0.0, peak = 0.0;
+	for (int k = 0; k < full_count / 2; k++)
+	{
+		max_error = fmax(max_error, hypot(real_out[k].re - complex_out[k].re, real_out[k].im - complex_out[k].im));
+		peak = fmax(peak, hypot(complex_out[k].re, complex_out[k].im));
+	}
+	fprintf(stderr, "Real input FFT relative error: %g\n", max_error / peak);
+	if (max_error / peak > MAX_RELATIVE_ERROR)
+	{
+		fprintf(stderr, "\tFAILED\n");
+		failures++;
+	}
+	delete complex_fft;
+	delete real_fft;
+
+	// compare windowed running max against a brute force max over the same window
+	WindowedMax running_max(TOTAL_BIN_DEPTH);
+	int history[FRAME_COUNT];
+	int mismatches = 0;
+	for (int frame = 0; frame < FRAME_COUNT; frame++)
+	{
+		history[frame] = (frame * 7919) % 97 + (frame / 50) * 20;
+		running_max.Push(history[frame]);
+		int expected = 0;
+		for (int i = frame; i >= 0 && i > frame - TOTAL_BIN_DEPTH; i--)
+		{
+			expected = fmax(expected, history[i]);
+		}
+		mismatches += running_max.Get() != expected;
+	}
+	fprintf(stderr, "Windowed max mismatches: %d\n", mismatches);
+	if (mismatches > 0)
+	{
+		fprintf(stderr, "\tFAILED\n");
+		failures++;
+	}
+
+	// compare stft frames against the last fft size samples of the stream
+	STFT stft(FFT_LOG, STFT_HOP);
+	short stream[FRAME_COUNT * STFT_HOP];
+	mismatches = 0;
+	for (int frame = 0; frame < FRAME_COUNT; frame++)
+	{
+		for (int i = 0; i < STFT_HOP; i++)
+		{
+			stream[frame * STFT_HOP + i] = (short)((frame * STFT_HOP + i) * 7919 % 65536 - 32768);
+		}
+		short* window = stft.Push(stream + frame * STFT_HOP);
+		int end = (frame + 1) * STFT_HOP;
+		for (int i = 0; i < full_count; i++)
+		{
+			int index = end - full_count + i;
+			mismatches += window[i] != (index < 0 ? 0 : stream[index]);
+		}
+	}
+	fprintf(stderr, "STFT frame mismatches: %d\n", mismatches);
+	if (mismatches > 0)
+	{
+		fprintf(stderr, "\tFAILED\n");
+		failures++;
+	}
+
+	// stream a counting sequence through the capture ring from a producer thread
+	SampleRing ring(1024);
+	std::thread producer([&ring]()
+	{
+		short chunk[STFT_HOP];
+		for (int sent = 0; sent < RING_SAMPLE_COUNT; sent += STFT_HOP)
+		{
+			for (int i = 0; i < STFT_HOP; i++)
+			{
+				chunk[i] = (short)(sent + i);
+			}
+			// wait for space most of the time, but overflow the ring every 64th chunk
+			while ((sent / STFT_HOP) % 64 != 0 && ring.GetAvailable() > ring.GetCapacity() - STFT_HOP)
+			{
+				std::this_thread::yield();
+			}
+			ring.Write(chunk, STFT_HOP);
+		}
+	});
+	// received samples must keep moving forward, skipping only what the ring reports as dropped
+	short chunk[STFT_HOP / 2];
+	short previous = -1;
+	unsigned long received = 0;
+	mismatches = 0;
+	while (received + ring.GetDropped() < RING_SAMPLE_COUNT)
+	{
+		if (!ring.Read(chunk, STFT_HOP / 2))
+			continue;
+		for (int i = 0; i < STFT_HOP / 2; i++)
+		{
+			mismatches += (short)(chunk[i] - previous) <= 0;
+			previous = chunk[i];
+		}
+		received += STFT_HOP / 2;
+	}
+	producer.join();
+	fprintf(stderr, "Sample ring: %lu received, %lu dropped, %d out of order\n", received, ring.GetDropped(), mismatches);
+	if (mismatches > 0 || received + ring.GetDropped() != RING_SAMPLE_COUNT)
+	{
+		fprintf(stderr, "\tFAILED\n");
+		failures++;
+	}
+
+	// hand counters through a triple buffer, the consumer must only ever see whole, newer values
+	TripleBuffer<int[STFT_HOP]> handoff;
+	std::thread publisher([&handoff]()
+	{
+		for (int value = 1; value <= RING_SAMPLE_COUNT / STFT_HOP; value++)
+		{
+			int* slot = handoff.GetBack();
+			for (int i = 0; i < STFT_HOP; i++)
+			{
+				slot[i] = value;
+			}
+			handoff.Publish();
+			std::this_thread::yield();
+		}
+	});
+	int last = 0;
+	received = 0;
+	mismatches = 0;
+	while (last < RING_SAMPLE_COUNT / STFT_HOP)
+	{
+		if (!handoff.Update())
+			continue;
+		const int* slot = handoff.GetFront();
+		for (int i = 0; i < STFT_HOP; i++)
+		{
+			mismatches += slot[i] != slot[0];
+		}
+		mismatches += slot[0] <= last;
+		last = slot[0];
+		received++;
+	}
+	publisher.join();
+	fprintf(stderr, "Triple buffer: %lu of %d values seen, %d torn or out of order\n", received, RING_SAMPLE_COUNT / STFT_HOP, mismatches);
+	if (mismatches > 0)
+	{
+		fprintf(stderr, "\tFAILED\n");
+		failures++;
+	}
+
+	// replay a synthetic tone as fast as possible, nothing may be dropped or reordered
+	SyntheticAudioSource source(ToneSyntheticSignalType, 440.0, 0.0, 0.5, 1.0, false);
+	source.Start();
+	received = 0;
+	mismatches = 0;
+	bool capturing = true;
+	while (capturing)
+	{
+		capturing = source.IsCapturing();
+		while (source.Read(chunk, STFT_HOP / 2))
+		{
+			for (int i = 0; i < STFT_HOP / 2; i++)
+			{
+				mismatches += chunk[i] != source.Generate(received + i);
+			}
+			received += STFT_HOP / 2;
+			source.Discard(0);
+		}
+	}
+	source.Stop();
+	fprintf(stderr, "Synthetic replay: %lu received, %lu dropped, %d mismatches\n", received, source.GetDroppedSamples(), mismatches);
+	if (mismatches > 0 || received != SAMP_RATE / (STFT_HOP / 2) * (STFT_HOP / 2))
+	{
+		fprintf(stderr, "\tFAILED\n");
+		failures++;
+	}
+
+	// compare table driven transfer functions against libm
+	TransferFunction transfer;
+	mismatches = 0;
+	for (int value = -1; value <= (1 << 20); value++)
+	{
+		mismatches += transfer.Decibels(value) != (value > 0 ? (int)(20.0 * log10(value)) : 0);
+	}
+	for (int value = 1 << 20; value > 0 && value < INT32_MAX - 7919; value += (value >> 10) + 7919)
+	{
+		mismatches += transfer.Decibels(value) != (int)(20.0 * log10(value));
+	}
+	for (int value = 0; value < 300; value++)
+	{
+		mismatches += transfer.Sigmoid(value) != (int)transfer.SigmoidFunction((double)value);
+	}
+	fprintf(stderr, "Transfer function mismatches: %d\n", mismatches);
+	if (mismatches > 0)
+	{
+		fprintf(stderr, "\tFAILED\n");
+		failures++;
+	}
+
+	// pace frames on the monotonic clock, then stall long enough that missed frames get skipped
+	FrameScheduler scheduler(SCHEDULER_FPS, 2);
+	for (int frame = 0; frame < 10; frame++)
+	{
+		scheduler.Wait();
+	}
+	float paced_seconds = scheduler.GetSeconds();
+	usleep(100000);
+	scheduler.Wait();
+	fprintf(stderr, "Frame scheduler: 10 frames in %.3f s, %lu skipped after a 0.1 s stall\n", paced_seconds, scheduler.GetSkippedFrames());
+	if (paced_seconds < 9.0 / SCHEDULER_FPS || scheduler.GetSkippedFrames() < 5)
+	{
+		fprintf(stderr, "\tFAILED\n");
+		failures++;
+	}
+
+	// render layers through rotated panels onto a virtual matrix, every pixel must land where the panel layout says
+	std::vector<GridTransformer::Panel> panels = { { 1, 0, 0 }, { 0, 90, 0 }, { 1, 180, 1 }, { 0, 270, 1 } };
+	VirtualMatrix virtual_matrix(2 * PANEL_SIZE, 2 * PANEL_SIZE);
+	GridTransformer grid(2 * PANEL_SIZE, 2 * PANEL_SIZE, PANEL_SIZE, PANEL_SIZE, 2, panels, virtual_matrix.GetOffscreen());
+	grid.EnableCutoff(false);
+	Compositor compositor(2 * PANEL_SIZE, 2 * PANEL_SIZE, 1);
+	mismatches = 0;
+	for (int frame = 0; frame < 3; frame++)
+	{
+		// frame 1 leaves the bottom half black, it must be erased from the canvas drawn two frames earlier
+		uint8_t* layer = compositor.GetLayer(0);
+		compositor.ClearLayer(0);
+		for (int y = 0; y < (frame == 1 ? PANEL_SIZE : 2 * PANEL_SIZE); y++)
+		{
+			for (int x = 0; x < 2 * PANEL_SIZE; x++)
+			{
+				layer[3 * (y * 2 * PANEL_SIZE + x)] = x + 1;
+				layer[3 * (y * 2 * PANEL_SIZE + x) + 1] = y + 1;
+				layer[3 * (y * 2 * PANEL_SIZE + x) + 2] = frame;
+			}
+		}
+		grid.ResetScreen();
+		compositor.Compose(&grid);
+		grid.FinishFrame();
+		grid.SetSource(virtual_matrix.Swap(1));
+		const uint8_t* image = virtual_matrix.GetFrame();
+		for (int y = 0; y < 2 * PANEL_SIZE; y++)
+		{
+			for (int x = 0; x < 2 * PANEL_SIZE; x++)
+			{
+				const GridTransformer::Panel& panel = panels[(y / PANEL_SIZE) * 2 + x / PANEL_SIZE];
+				int px = x % PANEL_SIZE, py = y % PANEL_SIZE, last = PANEL_SIZE - 1;
+				int rx = panel.rotate == 90 ? last - py : panel.rotate == 180 ? last - px : panel.rotate == 270 ? py : px;
+				int ry = panel.rotate == 90 ? px : panel.rotate == 180 ? last - py : panel.rotate == 270 ? last - px : py;
+				const uint8_t* pixel = image + 3 * (((panel.parallel * PANEL_SIZE + ry) * 2 + 1 - panel.order) * PANEL_SIZE + rx);
+				bool lit = frame != 1 || y < PANEL_SIZE;
+				mismatches += pixel[0] != (lit ? x + 1 : 0) || pixel[1] != (lit ? y + 1 : 0) || pixel[2] != (lit ? frame : 0);
+			}
+		}
+	}
+	fprintf(stderr, "Virtual matrix mismatches: %d\n", mismatches);
+	if (mismatches > 0)
+	{
+		fprintf(stderr, "\tFAILED\n");
+		failures++;
+	}
+
+	// numbered sequences take exactly one integer conversion, anything else must be refused before a frame is written
+	const char* bad_sequences[] = { "frames/%s.ppm", "frames/%d-%d.ppm", "frames/%%.ppm", "frames/%f.ppm" };
+	int accepted = 0;
+	for (const char* sequence : bad_sequences)
+	{
+		try
+		{
+			VirtualMatrix sequence_matrix(PANEL_SIZE, PANEL_SIZE, sequence);
+			accepted++;
+		}
+		catch (const invalid_argument&)
+		{
+		}
+	}
+	fprintf(stderr, "Invalid sequences accepted: %d\n", accepted);
+	if (accepted > 0)
+	{
+		fprintf(stderr, "\tFAILED\n");
+		failures++;
+	}
+
+	// limit white, gray and gradient frames, the drive the panels really get (channel value scaled by brightness, then the
+	// CIE1931 curve) must stay within budget and one more brightness step must exceed it; then recover once it goes dark
+	VirtualMatrix power_matrix(PANEL_SIZE, PANEL_SIZE);
+	std::vector<GridTransformer::Panel> power_panels = { { 0, 0, 0 } };
+	GridTransformer power_grid(PANEL_SIZE, PANEL_SIZE, PANEL_SIZE, PANEL_SIZE, 1, power_panels, power_matrix.GetOffscreen());
+	power_grid.EnableCutoff(false);
+	auto panel_drive = [](int value, int brightness)
+	{
+		double v = (double)value * brightness / 255.0;
+		return v <= 8 ? v / 902.3 : pow((v + 16) / 116.0, 3);
+	};
+	const int power_levels[] = { 225, 64, 40, 64 };
+	// white, 128 gray, 128 gray, horizontal gradient
+	const int power_values[] = { 255, 128, 128, -1 };
+	std::vector<uint8_t> power_row(3 * PANEL_SIZE);
+	mismatches = 0;
+	for (int test = 0; test < 4; test++)
+	{
+		for (int x = 0; x < PANEL_SIZE; x++)
+		{
+			int value = power_values[test] >= 0 ? power_values[test] : 8 * x + 7;
+			power_row[3 * x] = power_row[3 * x + 1] = power_row[3 * x + 2] = value;
+		}
+		power_grid.ResetScreen();
+		for (int y = 0; y < PANEL_SIZE; y++)
+		{
+			power_grid.SetRow(y, 0, power_row.data(), PANEL_SIZE);
+		}
+		power_grid.FinishFrame();
+		PowerLimiter limiter(power_levels[test], 100);
+		int brightness = limiter.Update(power_grid.GetLevels());
+		double budget = panel_drive(power_levels[test], 100), drive = 0.0, brighter = 0.0;
+		for (int x = 0; x < PANEL_SIZE; x++)
+		{
+			drive += panel_drive(power_row[3 * x], brightness) / PANEL_SIZE;
+			brighter += panel_drive(power_row[3 * x], brightness + 1) / PANEL_SIZE;
+		}
+		fprintf(stderr, "Power limiter: level %d frame limited to %d%%, drive %.4f of budget %.4f\n", power_levels[test], brightness, drive, budget);
+		mismatches += drive > budget * 1.0001 || (brightness < 100 && brighter <= budget);
+	}
+	PowerLimiter recovering(225, 100);
+	std::fill(power_row.begin(), power_row.end(), 255);
+	power_grid.ResetScreen();
+	for (int y = 0; y < PANEL_SIZE; y++)
+	{
+		power_grid.SetRow(y, 0, power_row.data(), PANEL_SIZE);
+	}
+	power_grid.FinishFrame();
+	int white_brightness = recovering.Update(power_grid.GetLevels());
+	power_grid.ResetScreen();
+	power_grid.SetRow(0, 0, power_row.data(), PANEL_SIZE);
+	power_grid.FinishFrame();
+	int dark_brightness = recovering.Update(power_grid.GetLevels());
+	fprintf(stderr, "Power limiter: full white at %d%%, one row at %d%%\n", white_brightness, dark_brightness);
+	if (mismatches > 0 || white_brightness >= 100 || dark_brightness != 100)
+	{
+		fprintf(stderr, "\tFAILED\n");
+		failures++;
+	}
+
+	// wrap a bin history several times, every depth must hold the row appended that many rows ago (and unwritten depths zero)
+	BinHistory bin_history(BIN_COUNT, BIN_DEPTH);
+	mismatches = 0;
+	for (int n = 0; n < 3 * BIN_DEPTH + 3; n++)
+	{
+		int* row = bin_history.Append();
+		for (int j = 0; j < BIN_COUNT; j++)
+		{
+			mismatches += row[j] != 0;
+			row[j] = n * BIN_COUNT + j;
+		}
+		for (int d = 0; d < BIN_DEPTH; d++)
+		{
+			for (int j = 0; j < BIN_COUNT; j++)
+			{
+				mismatches += bin_history.Get(d)[j] != (d <= n ? (n - d) * BIN_COUNT + j : 0);
+			}
+		}
+	}
+	fprintf(stderr, "Bin history mismatches: %d\n", mismatches);
+	if (mismatches > 0)
+	{
+		fprintf(stderr, "\tFAILED\n");
+		failures++;
+	}
+
+	// run the full analysis path (cpu backend, so the result is exact), the newest row is handed back and the color gains
+	// weigh the displayed rows by age
+	FFT * fft = new FFT(FFT_LOG, SAMP_RATE, CPUFFTBackendType);
+	fft->Create(BIN_COUNT, TOTAL_BIN_DEPTH);
+	BinHistory* cycled = NULL;
+	for (int frame = 0; frame < FRAME_COUNT; frame++)
+	{
+		float amplitude = 16000.0 * (float)(frame % 64) / 64.0;
+		for (int i = 0; i < full_count; i++)
+		{
+			buffer[i] = (short)(amplitude * cos(2.0 * GPU_FFT_PI * (3.0 + frame % 40) * i / full_count));
+		}
+		cycled = fft->Cycle(buffer, BIN_DEPTH, (float)frame / 20.0);
+	}
+	float red_gain = 0.0, green_gain = 0.0, blue_gain = 0.0;
+	fft->GetColorGains(red_gain, green_gain, blue_gain);
+	fprintf(stderr, "Color gains after %d frames: %f %f %f\n", FRAME_COUNT, red_gain, green_gain, blue_gain);
+	if (cycled == NULL || cycled->GetCount() != BIN_COUNT || cycled->GetDepth() != TOTAL_BIN_DEPTH
+		|| fabs(red_gain - EXPECTED_RED_GAIN) > MAX_GAIN_ERROR || fabs(green_gain - EXPECTED_GREEN_GAIN) > MAX_GAIN_ERROR
+		|| fabs(blue_gain - EXPECTED_BLUE_GAIN) > MAX_GAIN_ERROR)
+	{
+		fprintf(stderr, "\tFAILED\n");
+		failures++;
+	}
 	delete fft;
-	return 0;
-}
\ No newline at end of file
+	return failures;
+}
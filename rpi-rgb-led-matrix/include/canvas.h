@@ -31,6 +31,15 @@ public:
 
   // Fill screen with given 24bpp color.
   virtual void Fill(uint8_t red, uint8_t green, uint8_t blue) = 0;
+
+  // Set a horizontal run of "count" pixels starting at (x,y) from packed
+  // 24bpp "rgb" data (red, green, blue per pixel). The default writes one
+  // pixel at a time; canvases backed by a framebuffer write the run directly.
+  virtual void SetPixels(int x, int y, int count, const uint8_t *rgb) {
+    for (int i = 0; i < count; ++i, rgb += 3) {
+      SetPixel(x + i, y, rgb[0], rgb[1], rgb[2]);
+    }
+  }
 };
 
 // A canvas transformer is an object that, given a Canvas, returns a
@@ -48,6 +48,10 @@ class GPIO {
   // Set the bits that are '1' in the output. Leave the rest untouched.
   inline void SetBits(uint32_t value) {
     if (!value) return;
+#ifdef RGB_MOCK_GPIO
+    ++set_count_;
+    levels_ |= value;
+#endif
     *gpio_set_bits_ = value;
     for (int i = 0; i < slowdown_; ++i) {
       *gpio_set_bits_ = value;
@@ -57,6 +61,10 @@ class GPIO {
   // Clear the bits that are '1' in the output. Leave the rest untouched.
   inline void ClearBits(uint32_t value) {
     if (!value) return;
+#ifdef RGB_MOCK_GPIO
+    ++clear_count_;
+    levels_ &= ~value;
+#endif
     *gpio_clr_bits_ = value;
     for (int i = 0; i < slowdown_; ++i) {
       *gpio_clr_bits_ = value;
@@ -73,9 +81,27 @@ class GPIO {
 
   inline void Write(uint32_t value) { WriteMaskedBits(value, output_bits_); }
 
+#ifdef RGB_MOCK_GPIO
+  // Off-device builds: the registers are plain RAM. These count the
+  // SetBits()/ClearBits() calls that reached it (each one is 1 + slowdown
+  // register writes) and track the resulting pin levels.
+  uint64_t set_count() const { return set_count_; }
+  uint64_t clear_count() const { return clear_count_; }
+  uint64_t register_writes() const {
+    return (set_count_ + clear_count_) * (1 + slowdown_);
+  }
+  uint32_t levels() const { return levels_; }
+  void ResetCounts() { set_count_ = clear_count_ = 0; }
+#endif
+
  private:
   uint32_t output_bits_;
   int slowdown_;
+#ifdef RGB_MOCK_GPIO
+  uint64_t set_count_;
+  uint64_t clear_count_;
+  uint32_t levels_;
+#endif
   volatile uint32_t *gpio_port_;
   volatile uint32_t *gpio_set_bits_;
   volatile uint32_t *gpio_clr_bits_;
@@ -102,6 +128,14 @@ public:
 
   // If SendPulse() is asynchronously implemented, wait for pulse to finish.
   virtual void WaitPulseFinished() {}
+
+#ifdef RGB_MOCK_GPIO
+  // Off-device builds never sleep; pulses are only counted. These are the
+  // totals over all pulsers since the last ResetMockPulses().
+  static uint64_t mock_pulse_count();
+  static uint64_t mock_pulse_nanos();
+  static void ResetMockPulses();
+#endif
 };
 
 }  // end namespace rgb_matrix
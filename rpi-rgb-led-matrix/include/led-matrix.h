@@ -92,6 +92,11 @@ public:
     // Flag: --led-pwm-bits
     int pwm_bits;
 
+    // Bitplanes below pwm_bits that are shown in turn across refreshes
+    // (temporal dithering), so e.g. 7 pwm bits with 3 dither bits look like
+    // 10 bits at close to the refresh-rate of 7. 0..4, default 0 (off).
+    int pwm_dither_bits;
+
     // Change the base time-unit for the on-time in the lowest
     // significant bit in nanoseconds.
     // Higher numbers provide better quality (more accurate color, less
@@ -183,6 +188,12 @@ public:
   bool SetPWMBits(uint8_t value);
   uint8_t pwmbits();   // return the pwm-bits of the currently active buffer.
 
+  // Set the temporal dither bits (see Options::pwm_dither_bits), for the
+  // current active FrameCanvas and future ones created with
+  // CreateFrameCanvas(). Returns boolean to signify if value was within range.
+  bool SetPWMDitherBits(uint8_t value);
+  uint8_t pwmditherbits();
+
   // Map brightness of output linearly to input with CIE1931 profile.
   void set_luminance_correct(bool on);
   bool luminance_correct() const;
@@ -222,6 +233,22 @@ public:
   // 28Hz animation, nicely locked to the frame-rate).
   FrameCanvas *SwapOnVSync(FrameCanvas *other, unsigned framerate_fraction = 1);
 
+  // Non-blocking variant of SwapOnVSync(): queues "other" to be shown at the
+  // next matching frame boundary and returns a buffer that is no longer
+  // shown, to draw the following frame into.
+  // If the queue is full or no buffer is free yet, nothing is queued and NULL
+  // is returned; keep "other" and try again later (or draw the next frame
+  // into it instead). The first call creates one extra buffer, as nothing can
+  // be free right after queueing with just two.
+  FrameCanvas *TrySwap(FrameCanvas *other, unsigned framerate_fraction = 1);
+
+  // Number of frames that may be waiting to be shown (1..8, default 1).
+  // With a deeper queue, SwapOnVSync() returns as soon as a buffer is free
+  // instead of waiting for "other" to be shown, so the caller can run up to
+  // depth - 1 frames ahead of the display. The extra buffers this needs are
+  // created here. Returns false if out of range or not refreshing.
+  bool SetSwapQueueDepth(int depth);
+
   // Set image transformer that maps the logical canvas coordinates to the
   // physical canvas coordinates.
   // This preprocesses the transformation for static pixel mapping once.
@@ -259,6 +286,7 @@ public:
   virtual int height() const;
   virtual void SetPixel(int x, int y,
                         uint8_t red, uint8_t green, uint8_t blue);
+  virtual void SetPixels(int x, int y, int count, const uint8_t *rgb);
   virtual void Clear();
   virtual void Fill(uint8_t red, uint8_t green, uint8_t blue);
 
@@ -275,6 +303,8 @@ private:
   Mutex active_frame_sync_;
   CanvasTransformer *transformer_;  // deprecated. To be removed.
   UpdateThread *updater_;
+  int spare_frames_;      // created for SetSwapQueueDepth()
+  bool try_swap_spare_;   // extra buffer for TrySwap() created
   std::vector<FrameCanvas*> created_frames_;
   internal::PixelMapper *shared_pixel_mapper_;
 };
@@ -288,6 +318,10 @@ public:
   bool SetPWMBits(uint8_t value);
   uint8_t pwmbits();
 
+  // Set temporal dither bits used for this Frame (0..4, 0 = off).
+  bool SetPWMDitherBits(uint8_t value);
+  uint8_t pwmditherbits();
+
   // Map brightness of output linearly to input with CIE1931 profile.
   void set_luminance_correct(bool on);
   bool luminance_correct() const;
@@ -324,6 +358,7 @@ public:
   virtual int height() const;
   virtual void SetPixel(int x, int y,
                         uint8_t red, uint8_t green, uint8_t blue);
+  virtual void SetPixels(int x, int y, int count, const uint8_t *rgb);
   virtual void Clear();
   virtual void Fill(uint8_t red, uint8_t green, uint8_t blue);
 
@@ -0,0 +1,144 @@
+// -*- mode: c++; c-basic-offset: 2; indent-tabs-mode: nil; -*-
+//
+// Off-device benchmark of the refresh hot loop: Framebuffer::DumpToMatrix()
+// against the RAM-backed GPIO of an RGB_MOCK_GPIO build (make dump-benchmark).
+//
+// For each rows/chain/parallel/pwm-bits combination this reports the CPU
+// time of one full scanout, the GPIO traffic it generates and the refresh
+// rate that traffic plus the requested OE on-time would allow on a device
+// with the given cost per register write.
+
+#include "framebuffer-internal.h"
+#include "gpio.h"
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifndef RGB_MOCK_GPIO
+#  error "dump-benchmark needs the mock GPIO (build with make dump-benchmark)"
+#endif
+
+using rgb_matrix::GPIO;
+using rgb_matrix::PinPulser;
+using rgb_matrix::internal::Framebuffer;
+using rgb_matrix::internal::PixelMapper;
+
+static const int kPanelColumns = 32;
+
+static int usage(const char *progname) {
+  fprintf(stderr, "usage: %s [options]\n", progname);
+  fprintf(stderr, "Options:\n"
+          "\t-f <frames>   : Scanouts timed per configuration (default 200).\n"
+          "\t-w <ns>       : Device cost of one GPIO register write (default 10).\n"
+          "\t-s <slowdown> : GPIO slowdown (default 1).\n"
+          "\t-l <ns>       : PWM LSB nanoseconds (default 130).\n"
+          "\t-m <mapping>  : Hardware mapping (default 'regular').\n"
+          "\t-d <bits>     : PWM dither bits (default 0).\n");
+  return 1;
+}
+
+static double Now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Runs in its own process: the GPIO setup in Framebuffer is once-only.
+static void RunConfiguration(const char *mapping, int rows, int chain,
+                             int parallel, int pwm_bits, int dither_bits,
+                             int frames,
+                             int slowdown, int lsb_nanos, double write_ns) {
+  Framebuffer::InitHardwareMapping(mapping);
+  GPIO io;
+  io.Init(slowdown);
+  Framebuffer::InitGPIO(&io, rows, parallel, true, lsb_nanos, 0);
+
+  const int columns = kPanelColumns * chain;
+  PixelMapper *mapper = NULL;
+  Framebuffer frame(rows, columns, parallel, 0, "RGB", false, &mapper);
+  frame.SetPWMBits(pwm_bits);
+  frame.SetPWMDitherBits(dither_bits);
+  for (int y = 0; y < rows * parallel; ++y) {
+    for (int x = 0; x < columns; ++x) {
+      frame.SetPixel(x, y, x * 7, y * 13, (x ^ y) * 5);
+    }
+  }
+
+  frame.DumpToMatrix(&io);  // warm up
+  io.ResetCounts();
+  PinPulser::ResetMockPulses();
+  const double start = Now();
+  for (int i = 0; i < frames; ++i) {
+    frame.DumpToMatrix(&io);
+  }
+  const double cpu_ms = (Now() - start) * 1000.0 / frames;
+
+  const double writes = (double)io.register_writes() / frames;
+  const double pulse_ns = (double)PinPulser::mock_pulse_nanos() / frames;
+  // No overlap of clocking and OE on-time assumed: a lower bound.
+  const double device_ns = writes * write_ns + pulse_ns;
+  printf("%4d %5d %8d %4d | %9.3f %10.0f %9.1f | %8.1f\n",
+         rows, chain, parallel, pwm_bits, cpu_ms, writes, pulse_ns / 1000.0,
+         1e9 / device_ns);
+}
+
+int main(int argc, char *argv[]) {
+  int frames = 200;
+  double write_ns = 10;
+  int slowdown = 1;
+  int lsb_nanos = 130;
+  int dither_bits = 0;
+  const char *mapping = "regular";
+
+  int opt;
+  while ((opt = getopt(argc, argv, "f:w:s:l:m:d:")) != -1) {
+    switch (opt) {
+    case 'f': frames = atoi(optarg); break;
+    case 'w': write_ns = atof(optarg); break;
+    case 's': slowdown = atoi(optarg); break;
+    case 'l': lsb_nanos = atoi(optarg); break;
+    case 'm': mapping = optarg; break;
+    case 'd': dither_bits = atoi(optarg); break;
+    default:
+      return usage(argv[0]);
+    }
+  }
+  if (frames < 1 || write_ns <= 0 || slowdown < 0 || lsb_nanos < 1
+      || dither_bits < 0 || dither_bits > 4)
+    return usage(argv[0]);
+
+  static const int kRows[] = { 16, 32, 64 };
+  static const int kChains[] = { 1, 4, 8 };
+  static const int kParallel[] = { 1, 3 };
+  static const int kPwmBits[] = { 1, 7, 11 };
+
+  printf("rows chain parallel pwm | cpu ms/frm  writes/frm  OE us/frm | est. Hz\n");
+  fflush(stdout);
+  for (int r : kRows) {
+    for (int c : kChains) {
+      for (int p : kParallel) {
+        for (int b : kPwmBits) {
+          const pid_t child = fork();
+          if (child == 0) {
+            RunConfiguration(mapping, r, c, p, b, dither_bits, frames,
+                             slowdown, lsb_nanos, write_ns);
+            fflush(stdout);
+            _exit(0);
+          }
+          int status = 0;
+          waitpid(child, &status, 0);
+          if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            fprintf(stderr, "%d rows, chain %d, parallel %d, pwm %d failed\n",
+                    r, c, p, b);
+            return 1;
+          }
+        }
+      }
+    }
+  }
+  return 0;
+}
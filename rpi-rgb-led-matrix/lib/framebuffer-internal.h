@@ -80,14 +80,27 @@ public:
   bool SetPWMBits(uint8_t value);
   uint8_t pwmbits() { return pwm_bits_; }
 
+  // Temporal dithering: keep this many bitplanes below the lowest PWM bit and
+  // show them in turn across successive refreshes, each for the duration of
+  // the lowest PWM bit. A cycle of 2^value refreshes then averages out to the
+  // color depth of pwm_bits + value, for the cost of clocking in one extra
+  // plane per row. 0 (default) switches it off; at most kMaxDitherBits.
+  // Like SetPWMBits(), this only affects newly set pixels.
+  bool SetPWMDitherBits(uint8_t value);
+  uint8_t pwmditherbits() { return dither_bits_; }
+
   // Map brightness of output linearly to input with CIE1931 profile.
-  void set_luminance_correct(bool on) { do_luminance_correct_ = on; }
+  void set_luminance_correct(bool on) {
+    do_luminance_correct_ = on;
+    color_table_valid_ = false;
+  }
   bool luminance_correct() const { return do_luminance_correct_; }
 
   // Set brightness in percent; range=1..100
   // This will only affect newly set pixels.
   void SetBrightness(uint8_t b) {
     brightness_ = (b <= 100 ? (b != 0 ? b : 1) : 100);
+    color_table_valid_ = false;
   }
   uint8_t brightness() { return brightness_; }
 
@@ -102,6 +115,8 @@ public:
   int width() const;
   int height() const;
   void SetPixel(int x, int y, uint8_t red, uint8_t green, uint8_t blue);
+  // Horizontal run of "count" pixels from packed 24bpp data.
+  void SetPixels(int x, int y, int count, const uint8_t *rgb);
   void Clear();
   void Fill(uint8_t red, uint8_t green, uint8_t blue);
 
@@ -117,8 +132,25 @@ private:
                                      gpio_bits_t default_b);
 
   void InitDefaultDesignator(int x, int y, PixelDesignator *designator);
+  inline void SetDesignator(const PixelDesignator *designator,
+                            uint8_t r, uint8_t g, uint8_t b);
+  // Bit-sliced conversion of up to kPixelBatch pixels into all bitplanes.
+  void SetPixelBatch(const PixelDesignator *designators, int count,
+                     const uint8_t *rgb);
   inline void  MapColors(uint8_t r, uint8_t g, uint8_t b,
                          uint16_t *red, uint16_t *green, uint16_t *blue);
+  // Fill color_table_ for the current brightness and luminance correction.
+  void BuildColorTable();
+  // Lowest bitplane written: the lowest PWM bit, or below it when dithering.
+  inline int MinStoredPlane() const;
+
+  // Scanout of all rows for one refresh. Instantiated for the common double
+  // row counts and scan modes so the row loop and row order are compile-time
+  // constants; <0, -1> reads both at run time. Picked once in the constructor.
+  template <int kDoubleRows, int kScanMode>
+  void DumpRows(GPIO *io, int min_bit_plane, int dither_plane);
+  typedef void (Framebuffer::*DumpRowsFunction)(GPIO *io, int min_bit_plane,
+                                                int dither_plane);
   const int rows_;     // Number of rows. 16 or 32.
   const int parallel_; // Parallel rows of chains. 1 or 2.
   const int height_;   // rows * parallel
@@ -129,12 +161,22 @@ private:
   const bool inverse_color_;
 
   uint8_t pwm_bits_;   // PWM bits to display.
+  uint8_t dither_bits_;  // Bitplanes below those, shown in turn.
   bool do_luminance_correct_;
   uint8_t brightness_;
 
+  // Output bitplane value of each 8-bit channel value, with brightness,
+  // luminance correction and color inversion already applied. Rebuilt on the
+  // first write after any of these changed.
+  uint16_t color_table_[256];
+  bool color_table_valid_;
+
   const int double_rows_;
   const size_t buffer_size_;
 
+  gpio_bits_t color_clk_mask_;  // Mask of bits while clocking in.
+  DumpRowsFunction dump_rows_;
+
   // The frame-buffer is organized in bitplanes.
   // Highest level (slowest to cycle through) are double rows.
   // For each double-row, we store pwm-bits columns of a bitplane.
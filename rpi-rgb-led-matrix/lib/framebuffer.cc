@@ -29,12 +29,40 @@
 
 #include "gpio.h"
 
+// Bit-slicing a run of pixels into bitplane words, four words at a time.
+#if defined(__SSE2__)
+#  include <emmintrin.h>
+#  define BITSLICE_VECTOR 1
+typedef __m128i bitslice_t;
+#  define BITSLICE_LOAD(p) _mm_loadu_si128((const __m128i *)(p))
+#  define BITSLICE_STORE(p, v) _mm_storeu_si128((__m128i *)(p), v)
+#  define BITSLICE_AND(a, b) _mm_and_si128(a, b)
+#  define BITSLICE_OR(a, b) _mm_or_si128(a, b)
+#  define BITSLICE_SET(a) _mm_set1_epi32(a)
+#  define BITSLICE_TEST(a, m) _mm_cmpeq_epi32(_mm_and_si128(a, m), m)
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#  include <arm_neon.h>
+#  define BITSLICE_VECTOR 1
+typedef uint32x4_t bitslice_t;
+#  define BITSLICE_LOAD(p) vld1q_u32(p)
+#  define BITSLICE_STORE(p, v) vst1q_u32(p, v)
+#  define BITSLICE_AND(a, b) vandq_u32(a, b)
+#  define BITSLICE_OR(a, b) vorrq_u32(a, b)
+#  define BITSLICE_SET(a) vdupq_n_u32(a)
+#  define BITSLICE_TEST(a, m) vtstq_u32(a, m)
+#endif
+
 namespace rgb_matrix {
 namespace internal {
 enum {
-  kBitPlanes = 11  // maximum usable bitplanes.
+  kBitPlanes = 11,  // maximum usable bitplanes.
+  kPixelBatch = 64,  // pixels converted per bulk pass (stack scratch space).
+  kMaxDitherBits = 4  // longest dither cycle is 16 refreshes.
 };
 
+// Position in the temporal dither cycle. Only the refresh thread advances it.
+static unsigned sDitherPass = 0;
+
 // We need one global instance of a timing correct pulser. There are different
 // implementations depending on the context.
 static PinPulser *sOutputEnablePulser = NULL;
@@ -200,7 +228,8 @@ Framebuffer::Framebuffer(int rows, int columns, int parallel,
     columns_(columns),
     scan_mode_(scan_mode),
     led_sequence_(led_sequence), inverse_color_(inverse_color),
-    pwm_bits_(kBitPlanes), do_luminance_correct_(true), brightness_(100),
+    pwm_bits_(kBitPlanes), dither_bits_(0),
+    do_luminance_correct_(true), brightness_(100), color_table_valid_(false),
     double_rows_(rows / SUB_PANELS_),
     buffer_size_(double_rows_ * columns_ * kBitPlanes * sizeof(gpio_bits_t)),
     shared_mapper_(mapper) {
@@ -218,6 +247,37 @@ Framebuffer::Framebuffer(int rows, int columns, int parallel,
 
   bitplane_buffer_ = new gpio_bits_t[double_rows_ * columns_ * kBitPlanes];
 
+  const struct HardwareMapping &h = *hardware_mapping_;
+  color_clk_mask_ = h.p0_r1 | h.p0_g1 | h.p0_b1 | h.p0_r2 | h.p0_g2 | h.p0_b2;
+  if (parallel_ >= 2) {
+    color_clk_mask_ |= h.p1_r1 | h.p1_g1 | h.p1_b1 | h.p1_r2 | h.p1_g2 | h.p1_b2;
+  }
+  if (parallel_ >= 3) {
+    color_clk_mask_ |= h.p2_r1 | h.p2_g1 | h.p2_b1 | h.p2_r2 | h.p2_g2 | h.p2_b2;
+  }
+  color_clk_mask_ |= h.clock;
+
+  // Scanout kernel for this geometry: 16, 32 and 64 row panels, progressive
+  // or interlaced. Anything else takes the generic one.
+  dump_rows_ = &Framebuffer::DumpRows<0, -1>;
+  const bool interlaced = (scan_mode_ == 1);
+  if (scan_mode_ == 0 || scan_mode_ == 1) {
+    switch (double_rows_) {
+    case 8:
+      dump_rows_ = interlaced ? &Framebuffer::DumpRows<8, 1>
+        : &Framebuffer::DumpRows<8, 0>;
+      break;
+    case 16:
+      dump_rows_ = interlaced ? &Framebuffer::DumpRows<16, 1>
+        : &Framebuffer::DumpRows<16, 0>;
+      break;
+    case 32:
+      dump_rows_ = interlaced ? &Framebuffer::DumpRows<32, 1>
+        : &Framebuffer::DumpRows<32, 0>;
+      break;
+    }
+  }
+
   // If we're the first Framebuffer created, the shared PixelMapper is
   // still NULL, so create one.
   // The first PixelMapper represents the physical layout of a standard matrix
@@ -342,6 +402,18 @@ bool Framebuffer::SetPWMBits(uint8_t value) {
   return true;
 }
 
+bool Framebuffer::SetPWMDitherBits(uint8_t value) {
+  if (value > kMaxDitherBits)
+    return false;
+  dither_bits_ = value;
+  return true;
+}
+
+inline int Framebuffer::MinStoredPlane() const {
+  const int min_bit_plane = kBitPlanes - pwm_bits_;
+  return min_bit_plane > dither_bits_ ? min_bit_plane - dither_bits_ : 0;
+}
+
 inline gpio_bits_t *Framebuffer::ValueAt(int double_row, int column, int bit) {
   return &bitplane_buffer_[ double_row * (columns_ * kBitPlanes)
                             + bit * columns_
@@ -391,25 +463,23 @@ static inline uint16_t DirectMapColor(uint8_t brightness, uint8_t c) {
   return (shift > 0) ? (c << shift) : (c >> -shift);
 }
 
+void Framebuffer::BuildColorTable() {
+  for (int c = 0; c < 256; ++c) {
+    uint16_t value = (do_luminance_correct_
+                      ? CIEMapColor(brightness_, c)
+                      : DirectMapColor(brightness_, c));
+    color_table_[c] = inverse_color_ ? ~value : value;
+  }
+  color_table_valid_ = true;
+}
+
 inline void Framebuffer::MapColors(
   uint8_t r, uint8_t g, uint8_t b,
   uint16_t *red, uint16_t *green, uint16_t *blue) {
-
-  if (do_luminance_correct_) {
-    *red   = CIEMapColor(brightness_, r);
-    *green = CIEMapColor(brightness_, g);
-    *blue  = CIEMapColor(brightness_, b);
-  } else {
-    *red   = DirectMapColor(brightness_, r);
-    *green = DirectMapColor(brightness_, g);
-    *blue  = DirectMapColor(brightness_, b);
-  }
-
-  if (inverse_color_) {
-    *red = ~(*red);
-    *green = ~(*green);
-    *blue = ~(*blue);
-  }
+  if (!color_table_valid_) BuildColorTable();
+  *red   = color_table_[r];
+  *green = color_table_[g];
+  *blue  = color_table_[b];
 }
 
 void Framebuffer::Fill(uint8_t r, uint8_t g, uint8_t b) {
@@ -421,7 +491,7 @@ void Framebuffer::Fill(uint8_t r, uint8_t g, uint8_t b) {
   gpio_bits_t all_g = h.p0_g1 | h.p0_g2 | h.p1_g1 | h.p1_g2 | h.p2_g1 | h.p2_g2;
   gpio_bits_t all_b = h.p0_b1 | h.p0_b2 | h.p1_b1 | h.p1_b2 | h.p2_b1 | h.p2_b2;
 
-  for (int b = kBitPlanes - pwm_bits_; b < kBitPlanes; ++b) {
+  for (int b = MinStoredPlane(); b < kBitPlanes; ++b) {
     uint16_t mask = 1 << b;
     gpio_bits_t plane_bits = 0;
     plane_bits |= ((red & mask) == mask)   ? all_r : 0;
@@ -440,9 +510,8 @@ void Framebuffer::Fill(uint8_t r, uint8_t g, uint8_t b) {
 int Framebuffer::width() const { return (*shared_mapper_)->width(); }
 int Framebuffer::height() const { return (*shared_mapper_)->height(); }
 
-void Framebuffer::SetPixel(int x, int y, uint8_t r, uint8_t g, uint8_t b) {
-  const PixelDesignator *designator = (*shared_mapper_)->get(x, y);
-  if (designator == NULL) return;
+inline void Framebuffer::SetDesignator(const PixelDesignator *designator,
+                                       uint8_t r, uint8_t g, uint8_t b) {
   const int pos = designator->gpio_word;
   if (pos < 0) return;  // non-used pixel marker.
 
@@ -450,22 +519,114 @@ void Framebuffer::SetPixel(int x, int y, uint8_t r, uint8_t g, uint8_t b) {
   MapColors(r, g, b, &red, &green, &blue);
 
   uint32_t *bits = bitplane_buffer_ + pos;
-  const int min_bit_plane = kBitPlanes - pwm_bits_;
+  const int min_bit_plane = MinStoredPlane();
   bits += (columns_ * min_bit_plane);
   const uint32_t r_bits = designator->r_bit;
   const uint32_t g_bits = designator->g_bit;
   const uint32_t b_bits = designator->b_bit;
   const uint32_t designator_mask = designator->mask;
-  for (uint16_t mask = 1<<min_bit_plane; mask != 1<<kBitPlanes; mask <<=1 ) {
-    uint32_t color_bits = 0;
-    if (red & mask)   color_bits |= r_bits;
-    if (green & mask) color_bits |= g_bits;
-    if (blue & mask)  color_bits |= b_bits;
+  // Branchless: each set channel bit turns into an all-ones mask.
+  for (int b = min_bit_plane; b < kBitPlanes; ++b) {
+    const uint32_t color_bits = (-((red >> b) & 1) & r_bits)
+      | (-((green >> b) & 1) & g_bits)
+      | (-((blue >> b) & 1) & b_bits);
     *bits = (*bits & designator_mask) | color_bits;
     bits += columns_;
   }
 }
 
+void Framebuffer::SetPixel(int x, int y, uint8_t r, uint8_t g, uint8_t b) {
+  const PixelDesignator *designator = (*shared_mapper_)->get(x, y);
+  if (designator == NULL) return;
+  SetDesignator(designator, r, g, b);
+}
+
+void Framebuffer::SetPixels(int x, int y, int count, const uint8_t *rgb) {
+  // Clip the run to the canvas once; designators of a row are contiguous.
+  const PixelMapper *mapper = *shared_mapper_;
+  if (y < 0 || y >= mapper->height()) return;
+  if (x < 0) {
+    count += x;
+    rgb -= 3 * x;
+    x = 0;
+  }
+  if (x + count > mapper->width()) count = mapper->width() - x;
+  if (count <= 0) return;
+  const PixelDesignator *designator = (*shared_mapper_)->get(x, y);
+  while (count > 0) {
+    const int n = count < kPixelBatch ? count : kPixelBatch;
+    SetPixelBatch(designator, n, rgb);
+    designator += n;
+    rgb += 3 * n;
+    count -= n;
+  }
+}
+
+void Framebuffer::SetPixelBatch(const PixelDesignator *designators, int count,
+                                const uint8_t *rgb) {
+  // Map the colors and gather the designators as structure-of-arrays, so
+  // every bitplane below is one sweep over its row of words.
+  uint32_t red[kPixelBatch], green[kPixelBatch], blue[kPixelBatch];
+  uint32_t r_bits[kPixelBatch], g_bits[kPixelBatch], b_bits[kPixelBatch];
+  uint32_t masks[kPixelBatch];
+  int pos[kPixelBatch];
+  int used = 0;
+  bool contiguous = true;
+  for (int i = 0; i < count; ++i, rgb += 3) {
+    const PixelDesignator &d = designators[i];
+    if (d.gpio_word < 0) continue;  // non-used pixel marker.
+    uint16_t r, g, b;
+    MapColors(rgb[0], rgb[1], rgb[2], &r, &g, &b);
+    red[used] = r;
+    green[used] = g;
+    blue[used] = b;
+    r_bits[used] = d.r_bit;
+    g_bits[used] = d.g_bit;
+    b_bits[used] = d.b_bit;
+    masks[used] = d.mask;
+    pos[used] = d.gpio_word;
+    if (used > 0 && pos[used] != pos[used - 1] + 1) contiguous = false;
+    ++used;
+  }
+  if (used == 0) return;
+
+  const int min_bit_plane = MinStoredPlane();
+  for (int b = min_bit_plane; b < kBitPlanes; ++b) {
+    const uint32_t plane_mask = 1 << b;
+    gpio_bits_t *plane = bitplane_buffer_ + columns_ * b;
+    int i = 0;
+#ifdef BITSLICE_VECTOR
+    if (contiguous) {
+      // Adjacent words: transpose four pixels' color bits per step.
+      const bitslice_t m = BITSLICE_SET(plane_mask);
+      gpio_bits_t *bits = plane + pos[0];
+      for (; i + 4 <= used; i += 4) {
+        bitslice_t color_bits = BITSLICE_OR(
+          BITSLICE_AND(BITSLICE_TEST(BITSLICE_LOAD(red + i), m),
+                       BITSLICE_LOAD(r_bits + i)),
+          BITSLICE_OR(
+            BITSLICE_AND(BITSLICE_TEST(BITSLICE_LOAD(green + i), m),
+                         BITSLICE_LOAD(g_bits + i)),
+            BITSLICE_AND(BITSLICE_TEST(BITSLICE_LOAD(blue + i), m),
+                         BITSLICE_LOAD(b_bits + i))));
+        bitslice_t word = BITSLICE_AND(BITSLICE_LOAD(bits + i),
+                                       BITSLICE_LOAD(masks + i));
+        BITSLICE_STORE(bits + i, BITSLICE_OR(word, color_bits));
+      }
+    }
+#endif
+    // Branchless scalar tail (and scattered words).
+    for (; i < used; ++i) {
+      const uint32_t color_bits =
+        (-((red[i] >> b) & 1) & r_bits[i])
+        | (-((green[i] >> b) & 1) & g_bits[i])
+        | (-((blue[i] >> b) & 1) & b_bits[i]);
+      gpio_bits_t *bits = plane + pos[i];
+      *bits = (*bits & masks[i]) | color_bits;
+    }
+  }
+}
+
 // Strange LED-mappings such as RBG or so are handled here.
 gpio_bits_t Framebuffer::GetGpioFromLedSequence(char col,
                                                 gpio_bits_t default_r,
@@ -544,24 +705,16 @@ void Framebuffer::CopyFrom(const Framebuffer *other) {
   memcpy(bitplane_buffer_, other->bitplane_buffer_, buffer_size_);
 }
 
-void Framebuffer::DumpToMatrix(GPIO *io) {
+template <int kDoubleRows, int kScanMode>
+void Framebuffer::DumpRows(GPIO *io, int min_bit_plane, int dither_plane) {
   const struct HardwareMapping &h = *hardware_mapping_;
-  gpio_bits_t color_clk_mask = 0;  // Mask of bits while clocking in.
-  color_clk_mask |= h.p0_r1 | h.p0_g1 | h.p0_b1 | h.p0_r2 | h.p0_g2 | h.p0_b2;
-  if (parallel_ >= 2) {
-    color_clk_mask |= h.p1_r1 | h.p1_g1 | h.p1_b1 | h.p1_r2 | h.p1_g2 | h.p1_b2;
-  }
-  if (parallel_ >= 3) {
-    color_clk_mask |= h.p2_r1 | h.p2_g1 | h.p2_b1 | h.p2_r2 | h.p2_g2 | h.p2_b2;
-  }
-
-  color_clk_mask |= h.clock;
-
-  const uint8_t half_double = double_rows_/2;
-  const int pwm_to_show = pwm_bits_;  // Local copy, might change in process.
-  for (uint8_t row_loop = 0; row_loop < double_rows_; ++row_loop) {
+  const gpio_bits_t color_clk_mask = color_clk_mask_;
+  const int double_rows = kDoubleRows > 0 ? kDoubleRows : double_rows_;
+  const int scan_mode = kScanMode >= 0 ? kScanMode : scan_mode_;
+  const uint8_t half_double = double_rows/2;
+  for (uint8_t row_loop = 0; row_loop < double_rows; ++row_loop) {
     uint8_t d_row;
-    switch (scan_mode_) {
+    switch (scan_mode) {
     case 0:  // progressive
     default:
       d_row = row_loop;
@@ -575,7 +728,8 @@ void Framebuffer::DumpToMatrix(GPIO *io) {
 
     // Rows can't be switched very quickly without ghosting, so we do the
     // full PWM of one row before switching rows.
-    for (int b = kBitPlanes - pwm_to_show; b < kBitPlanes; ++b) {
+    for (int b = (dither_plane >= 0 ? dither_plane : min_bit_plane);
+         b < kBitPlanes; b = (b < min_bit_plane ? min_bit_plane : b + 1)) {
       gpio_bits_t *row_data = ValueAt(d_row, 0, b);
       // While the output enable is still on, we can already clock in the next
       // data.
@@ -595,10 +749,31 @@ void Framebuffer::DumpToMatrix(GPIO *io) {
       io->SetBits(h.strobe);   // Strobe in the previously clocked in row.
       io->ClearBits(h.strobe);
 
-      // Now switch on for the sleep time necessary for that bit-plane.
-      sOutputEnablePulser->SendPulse(b);
+      // Now switch on for the sleep time necessary for that bit-plane
+      // (a dither plane stands in for the lowest PWM bit).
+      sOutputEnablePulser->SendPulse(b < min_bit_plane ? min_bit_plane : b);
     }
   }
 }
+
+void Framebuffer::DumpToMatrix(GPIO *io) {
+  const int pwm_to_show = pwm_bits_;  // Local copy, might change in process.
+  const int min_bit_plane = kBitPlanes - pwm_to_show;
+
+  // With dithering, one plane below the PWM bits is shown per refresh, for as
+  // long as the lowest PWM bit. Plane min_bit_plane - 1 - i comes up every
+  // 2^(i+1)th refresh (the trailing zeros of the pass count), so over the
+  // cycle each contributes exactly its binary weight. Pass 0 shows none.
+  int dither_plane = -1;
+  const int dither_bits = (dither_bits_ < min_bit_plane
+                           ? dither_bits_ : min_bit_plane);
+  if (dither_bits > 0) {
+    const unsigned pass = sDitherPass++ & ((1u << dither_bits) - 1);
+    if (pass != 0)
+      dither_plane = min_bit_plane - 1 - __builtin_ctz(pass);
+  }
+
+  (this->*dump_rows_)(io, min_bit_plane, dither_plane);
+}
 }  // namespace internal
 }  // namespace rgb_matrix
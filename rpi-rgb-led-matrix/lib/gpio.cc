@@ -133,6 +133,10 @@ namespace rgb_matrix {
 );
 
 GPIO::GPIO() : output_bits_(0), slowdown_(1), gpio_port_(NULL) {
+#ifdef RGB_MOCK_GPIO
+  set_count_ = clear_count_ = 0;
+  levels_ = 0;
+#endif
 }
 
 uint32_t GPIO::InitOutputs(uint32_t outputs,
@@ -198,6 +202,11 @@ static uint32_t JitterAllowanceMicroseconds() {
 }
 
 static uint32_t *mmap_bcm_register(bool isRPi2, off_t register_offset) {
+#ifdef RGB_MOCK_GPIO
+  // Off-device builds get a RAM-backed register file instead of /dev/mem
+  // (never released, like the real mapping).
+  return new uint32_t[REGISTER_BLOCK_SIZE / sizeof(uint32_t)]();
+#endif
   const off_t base = (isRPi2 ? BCM2709_PERI_BASE : BCM2708_PERI_BASE);
 
   int mem_fd;
@@ -559,13 +568,49 @@ private:
   bool triggered_;
 };
 
+#ifdef RGB_MOCK_GPIO
+static uint64_t mock_pulse_count_ = 0;
+static uint64_t mock_pulse_nanos_ = 0;
+
+// Stands in for both pulsers off-device: the OE pin still goes low and high
+// again, but instead of waiting we only add up the requested on-time.
+class MockPinPulser : public PinPulser {
+public:
+  MockPinPulser(GPIO *io, uint32_t bits, const std::vector<int> &nano_specs)
+    : io_(io), bits_(bits), nano_specs_(nano_specs) {}
+
+  virtual void SendPulse(int time_spec_number) {
+    io_->ClearBits(bits_);
+    ++mock_pulse_count_;
+    mock_pulse_nanos_ += nano_specs_[time_spec_number];
+    io_->SetBits(bits_);
+  }
+
+private:
+  GPIO *const io_;
+  const uint32_t bits_;
+  const std::vector<int> nano_specs_;
+};
+#endif
+
 } // end anonymous namespace
 
+#ifdef RGB_MOCK_GPIO
+/*static*/ uint64_t PinPulser::mock_pulse_count() { return mock_pulse_count_; }
+/*static*/ uint64_t PinPulser::mock_pulse_nanos() { return mock_pulse_nanos_; }
+/*static*/ void PinPulser::ResetMockPulses() {
+  mock_pulse_count_ = mock_pulse_nanos_ = 0;
+}
+#endif
+
 // Public PinPulser factory
 PinPulser *PinPulser::Create(GPIO *io, uint32_t gpio_mask,
                              bool allow_hardware_pulsing,
                              const std::vector<int> &nano_wait_spec) {
   if (!Timers::Init()) return NULL;
+#ifdef RGB_MOCK_GPIO
+  return new MockPinPulser(io, gpio_mask, nano_wait_spec);
+#endif
   if (allow_hardware_pulsing && HardwarePinPulser::CanHandle(gpio_mask)) {
     return new HardwarePinPulser(gpio_mask, nano_wait_spec);
   } else {
@@ -1,14 +1,20 @@
 #include "led-matrix.h"
 
 #include <assert.h>
+#include <limits.h>
+#include <linux/futex.h>
 #include <math.h>
 #include <pthread.h>
+#include <sched.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <stdio.h>
+#include <sys/syscall.h>
 #include <sys/time.h>
+#include <unistd.h>
+#include <atomic>
 #include <stdexcept>
 
 #include "gpio.h"
@@ -20,45 +26,117 @@ using namespace std;
 
 namespace rgb_matrix
 {
+// Single-producer single-consumer ring of frames. The producer only ever
+// advances head_, the consumer only tail_, so neither side needs a lock.
+class FrameQueue {
+public:
+  // Power of two, so the free-running indices wrap consistently.
+  static const unsigned kCapacity = 8;
+
+  FrameQueue() : head_(0), tail_(0) {}
+
+  unsigned size() const {
+    return head_.load(std::memory_order_acquire)
+      - tail_.load(std::memory_order_acquire);
+  }
+
+  bool Push(FrameCanvas *frame) {
+    const unsigned head = head_.load(std::memory_order_relaxed);
+    if (head - tail_.load(std::memory_order_acquire) == kCapacity)
+      return false;
+    frames_[head % kCapacity] = frame;
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  FrameCanvas *Pop() {
+    const unsigned tail = tail_.load(std::memory_order_relaxed);
+    if (tail == head_.load(std::memory_order_acquire))
+      return NULL;
+    FrameCanvas *const frame = frames_[tail % kCapacity];
+    tail_.store(tail + 1, std::memory_order_release);
+    return frame;
+  }
+
+private:
+  FrameCanvas *frames_[kCapacity];
+  std::atomic<unsigned> head_;
+  std::atomic<unsigned> tail_;
+};
+
+// The futex word is the vsync counter itself.
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),
+              "futex needs a plain 32 bit word");
+
+// Sleep while *word still holds "expected". May return spuriously.
+static void FutexWait(std::atomic<uint32_t> *word, uint32_t expected) {
+#ifdef __linux__
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT_PRIVATE,
+          expected, NULL, NULL, 0);
+#else
+  (void) word; (void) expected;
+  sched_yield();
+#endif
+}
+
+static void FutexWakeAll(std::atomic<uint32_t> *word) {
+#ifdef __linux__
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE_PRIVATE,
+          INT_MAX, NULL, NULL, 0);
+#else
+  (void) word;
+#endif
+}
+
 // Pump pixels to screen. Needs to be high priority real-time because jitter
+//
+// Frames travel from the renderer to the refresh thread through the pending_
+// queue and come back through retired_ once they have been replaced. Every
+// frame boundary bumps vsync_count_; a renderer that has to wait sleeps on
+// that counter with a futex. The refresh loop itself never takes a lock and
+// only makes a system call when somebody is actually waiting.
 class RGBMatrix::UpdateThread : public Thread
 {
 public:
   UpdateThread(GPIO *io, FrameCanvas *initial_frame)
     : io_(io), running_(true),
-      current_frame_(initial_frame), next_frame_(NULL),
-      requested_frame_multiple_(1) {
-    pthread_cond_init(&frame_done_, NULL);
+      current_frame_(initial_frame),
+      requested_frame_multiple_(1),
+      vsync_count_(0), waiting_(false), queue_depth_(1) {
   }
 
   void Stop()
   {
-    MutexLock l(&running_mutex_);
-    running_ = false;
+    running_.store(false, std::memory_order_relaxed);
   }
 
   virtual void Run()
   {
     unsigned frame_count = 0;
-    while (running())
+    FrameCanvas *current = current_frame_.load(std::memory_order_relaxed);
+    while (running_.load(std::memory_order_relaxed))
 	{
 
-      current_frame_->framebuffer()->DumpToMatrix(io_);
-
-      {
-        MutexLock l(&frame_sync_);
-        // Do fast equality test first (likely due to frame_count reset).
-        if (frame_count == requested_frame_multiple_
-            || frame_count % requested_frame_multiple_ == 0) {
-          // We reset to avoid frame hick-up every couple of weeks
-          // run-time iff requested_frame_multiple_ is not a factor of 2^32.
-          frame_count = 0;
-          if (next_frame_ != NULL) {
-            current_frame_ = next_frame_;
-            next_frame_ = NULL;
-          }
-          pthread_cond_signal(&frame_done_);
+      current->framebuffer()->DumpToMatrix(io_);
+
+      const unsigned multiple =
+        requested_frame_multiple_.load(std::memory_order_relaxed);
+      // Do fast equality test first (likely due to frame_count reset).
+      if (frame_count == multiple || frame_count % multiple == 0) {
+        // We reset to avoid frame hick-up every couple of weeks
+        // run-time iff requested_frame_multiple_ is not a factor of 2^32.
+        frame_count = 0;
+        FrameCanvas *const next = pending_.Pop();
+        if (next != NULL) {
+          // Can't overflow: a frame only retires for one that was queued,
+          // and every queued frame took a free one out.
+          retired_.Push(current);
+          current = next;
+          current_frame_.store(current, std::memory_order_relaxed);
         }
+        vsync_count_.fetch_add(1);
+        if (waiting_.load() && waiting_.exchange(false))
+          FutexWakeAll(&vsync_count_);
       }
 
       ++frame_count;
@@ -68,29 +146,79 @@ public:
 
   FrameCanvas *SwapOnVSync(FrameCanvas *other, unsigned frame_fraction)
   {
-    MutexLock l(&frame_sync_);
-    FrameCanvas *previous = current_frame_;
-    next_frame_ = other;
-    requested_frame_multiple_ = frame_fraction;
-    frame_sync_.WaitOn(&frame_done_);
-    return previous;
+    requested_frame_multiple_.store(frame_fraction, std::memory_order_relaxed);
+    if (other == NULL) {
+      WaitForVSync(vsync_count_.load(std::memory_order_acquire));
+      return current_frame_.load(std::memory_order_relaxed);
+    }
+    // Wait for room in the queue...
+    for (;;) {
+      const uint32_t seen = vsync_count_.load(std::memory_order_acquire);
+      if (pending_.size() < queue_depth_) break;
+      WaitForVSync(seen);
+    }
+    pending_.Push(other);
+    // ... and for a frame that is no longer shown. With a queue depth of one
+    // that is the frame "other" replaces, at the next matching boundary.
+    for (;;) {
+      const uint32_t seen = vsync_count_.load(std::memory_order_acquire);
+      FrameCanvas *const free_frame = TakeFree();
+      if (free_frame != NULL) return free_frame;
+      WaitForVSync(seen);
+    }
+  }
+
+  FrameCanvas *TrySwap(FrameCanvas *other, unsigned frame_fraction)
+  {
+    if (other == NULL || pending_.size() >= queue_depth_)
+      return NULL;
+    FrameCanvas *const free_frame = TakeFree();
+    if (free_frame == NULL)
+      return NULL;
+    requested_frame_multiple_.store(frame_fraction, std::memory_order_relaxed);
+    pending_.Push(other);
+    return free_frame;
   }
 
+  // Renderer side only.
+  void AddSpare(FrameCanvas *frame) { spare_frames_.push_back(frame); }
+  int spare_count() const { return spare_frames_.size(); }
+  void set_queue_depth(unsigned depth) { queue_depth_ = depth; }
+
 private:
-  inline bool running() {
-    MutexLock l(&running_mutex_);
-    return running_;
+  FrameCanvas *TakeFree() {
+    FrameCanvas *frame = retired_.Pop();
+    if (frame == NULL && !spare_frames_.empty()) {
+      frame = spare_frames_.back();
+      spare_frames_.pop_back();
+    }
+    return frame;
+  }
+
+  // Returns once the vsync counter moved past "seen".
+  void WaitForVSync(uint32_t seen) {
+    while (vsync_count_.load(std::memory_order_acquire) == seen) {
+      waiting_.store(true);
+      // Re-check after announcing ourselves, the refresh thread might have
+      // passed the boundary before it could see waiting_.
+      if (vsync_count_.load() != seen) break;
+      FutexWait(&vsync_count_, seen);
+    }
   }
 
   GPIO *const io_;
-  Mutex running_mutex_;
-  bool running_;
-
-  Mutex frame_sync_;
-  pthread_cond_t frame_done_;
-  FrameCanvas *current_frame_;
-  FrameCanvas *next_frame_;
-  unsigned requested_frame_multiple_;
+  std::atomic<bool> running_;
+
+  std::atomic<FrameCanvas*> current_frame_;
+  std::atomic<unsigned> requested_frame_multiple_;
+  std::atomic<uint32_t> vsync_count_;
+  std::atomic<bool> waiting_;
+  FrameQueue pending_;   // renderer -> refresh thread
+  FrameQueue retired_;   // refresh thread -> renderer
+
+  // Only touched by the renderer.
+  unsigned queue_depth_;
+  std::vector<FrameCanvas*> spare_frames_;
 };
 
 // Some defaults. See options-initialize.cc for the command line parsing.
@@ -105,6 +233,7 @@ RGBMatrix::Options::Options() :
 #endif
 
   rows(32), cols(32), chain_length(1), parallel(1), pwm_bits(11),
+  pwm_dither_bits(0),
 
 #ifdef LSB_PWM_NANOSECONDS
     pwm_lsb_nanoseconds(LSB_PWM_NANOSECONDS),
@@ -140,7 +269,8 @@ RGBMatrix::Options::Options() :
 }
 
 RGBMatrix::RGBMatrix(int rows, int chained_displays, int parallel_displays)
-  : params_(Options()), updater_(NULL), shared_pixel_mapper_(NULL)
+  : params_(Options()), updater_(NULL), spare_frames_(0),
+    try_swap_spare_(false), shared_pixel_mapper_(NULL)
 {
 	params_.rows = rows;
 	params_.chain_length = chained_displays;
@@ -226,6 +356,7 @@ FrameCanvas *RGBMatrix::CreateFrameCanvas()
   }
 
   result->framebuffer()->SetPWMBits(params_.pwm_bits);
+  result->framebuffer()->SetPWMDitherBits(params_.pwm_dither_bits);
   result->framebuffer()->set_luminance_correct(do_luminance_correct_);
   result->framebuffer()->SetBrightness(params_.brightness);
 
@@ -241,6 +372,30 @@ FrameCanvas *RGBMatrix::SwapOnVSync(FrameCanvas *other,
   return previous;
 }
 
+FrameCanvas *RGBMatrix::TrySwap(FrameCanvas *other, unsigned frame_fraction) {
+  if (frame_fraction == 0) frame_fraction = 1; // correct user error.
+  if (!try_swap_spare_) {
+    // Nothing can be free right after queueing without one more buffer.
+    updater_->AddSpare(CreateFrameCanvas());
+    try_swap_spare_ = true;
+  }
+  FrameCanvas *const free_frame = updater_->TrySwap(other, frame_fraction);
+  if (free_frame) active_ = other;
+  return free_frame;
+}
+
+bool RGBMatrix::SetSwapQueueDepth(int depth) {
+  if (depth < 1 || depth > (int)FrameQueue::kCapacity || updater_ == NULL)
+    return false;
+  // Each queued frame beyond the first needs a buffer to draw into meanwhile.
+  while (spare_frames_ < depth - 1) {
+    updater_->AddSpare(CreateFrameCanvas());
+    ++spare_frames_;
+  }
+  updater_->set_queue_depth(depth);
+  return true;
+}
+
 bool RGBMatrix::SetPWMBits(uint8_t value) {
   const bool success = active_->framebuffer()->SetPWMBits(value);
   if (success) {
@@ -250,6 +405,15 @@ bool RGBMatrix::SetPWMBits(uint8_t value) {
 }
 uint8_t RGBMatrix::pwmbits() { return params_.pwm_bits; }
 
+bool RGBMatrix::SetPWMDitherBits(uint8_t value) {
+  const bool success = active_->framebuffer()->SetPWMDitherBits(value);
+  if (success) {
+    params_.pwm_dither_bits = value;
+  }
+  return success;
+}
+uint8_t RGBMatrix::pwmditherbits() { return params_.pwm_dither_bits; }
+
 // Map brightness of output linearly to input with CIE1931 profile.
 void RGBMatrix::set_luminance_correct(bool on) {
   active_->framebuffer()->set_luminance_correct(on);
@@ -283,6 +447,10 @@ void RGBMatrix::SetPixel(int x, int y, uint8_t red, uint8_t green, uint8_t blue)
   active_->SetPixel(x, y, red, green, blue);
 }
 
+void RGBMatrix::SetPixels(int x, int y, int count, const uint8_t *rgb) {
+  active_->SetPixels(x, y, count, rgb);
+}
+
 void RGBMatrix::Clear() {
   active_->Clear();
 }
@@ -371,12 +539,19 @@ void FrameCanvas::SetPixel(int x, int y,
                          uint8_t red, uint8_t green, uint8_t blue) {
   frame_->SetPixel(x, y, red, green, blue);
 }
+void FrameCanvas::SetPixels(int x, int y, int count, const uint8_t *rgb) {
+  frame_->SetPixels(x, y, count, rgb);
+}
 void FrameCanvas::Clear() { return frame_->Clear(); }
 void FrameCanvas::Fill(uint8_t red, uint8_t green, uint8_t blue) {
   frame_->Fill(red, green, blue);
 }
 bool FrameCanvas::SetPWMBits(uint8_t value) { return frame_->SetPWMBits(value); }
 uint8_t FrameCanvas::pwmbits() { return frame_->pwmbits(); }
+bool FrameCanvas::SetPWMDitherBits(uint8_t value) {
+  return frame_->SetPWMDitherBits(value);
+}
+uint8_t FrameCanvas::pwmditherbits() { return frame_->pwmditherbits(); }
 
 // Map brightness of output linearly to input with CIE1931 profile.
 void FrameCanvas::set_luminance_correct(bool on) { frame_->set_luminance_correct(on); }